@@ -0,0 +1,163 @@
+/**
+ * @file	array_transfer.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/24
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_ARRAY_TRANSFER_H_
+#define JCU_JVM_ARRAY_TRANSFER_H_
+
+#include <stddef.h>
+#include <string.h>
+
+#include <vector>
+
+#include <jni.h>
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Mapping of a primitive element type to its java array type and region functions
+ */
+template <class T>
+struct PrimitiveArrayType;
+
+#define JCU_JVM_PRIMITIVE_ARRAY_TYPE_(TYPE, NAME) \
+  template <> \
+  struct PrimitiveArrayType<TYPE> { \
+    typedef TYPE ## Array array_type; \
+    static array_type newArray(JNIEnv* env, jsize length) { \
+      return env->New ## NAME ## Array(length); \
+    } \
+    static void getRegion(JNIEnv* env, array_type array, jsize start, jsize length, TYPE* buf) { \
+      env->Get ## NAME ## ArrayRegion(array, start, length, buf); \
+    } \
+    static void setRegion(JNIEnv* env, array_type array, jsize start, jsize length, const TYPE* buf) { \
+      env->Set ## NAME ## ArrayRegion(array, start, length, buf); \
+    } \
+  }
+
+JCU_JVM_PRIMITIVE_ARRAY_TYPE_(jboolean, Boolean);
+JCU_JVM_PRIMITIVE_ARRAY_TYPE_(jbyte, Byte);
+JCU_JVM_PRIMITIVE_ARRAY_TYPE_(jchar, Char);
+JCU_JVM_PRIMITIVE_ARRAY_TYPE_(jshort, Short);
+JCU_JVM_PRIMITIVE_ARRAY_TYPE_(jint, Int);
+JCU_JVM_PRIMITIVE_ARRAY_TYPE_(jlong, Long);
+JCU_JVM_PRIMITIVE_ARRAY_TYPE_(jfloat, Float);
+JCU_JVM_PRIMITIVE_ARRAY_TYPE_(jdouble, Double);
+
+#undef JCU_JVM_PRIMITIVE_ARRAY_TYPE_
+
+/**
+ * Copy strategy of the array transfer helpers.
+ *
+ * Up to region_threshold_bytes a single Get/Set<Type>ArrayRegion call is
+ * used. Larger copies pin the array with GetPrimitiveArrayCritical once per
+ * critical_chunk_bytes, so the gc is never held off for longer than one
+ * chunk copy (about 100us for the default 1MiB).
+ */
+struct ArrayTransferOptions {
+  size_t region_threshold_bytes;
+  size_t critical_chunk_bytes;
+
+  ArrayTransferOptions()
+      : region_threshold_bytes(16 * 1024), critical_chunk_bytes(1024 * 1024) {}
+};
+
+namespace intl {
+
+template <class T, bool kToJava>
+bool transferArray(JNIEnv* env, typename PrimitiveArrayType<T>::array_type array, jsize start,
+                   T* data, size_t count, const ArrayTransferOptions& options) {
+  typedef PrimitiveArrayType<T> Traits;
+  size_t bytes = count * sizeof(T);
+  jsize length = count ? env->GetArrayLength(array) : 0;
+
+  // out of range copies go through the region call, which throws ArrayIndexOutOfBoundsException
+  if (bytes <= options.region_threshold_bytes || start < 0 || (size_t) start > (size_t) length
+      || count > (size_t) (length - start)) {
+    if (kToJava) {
+      Traits::setRegion(env, array, start, (jsize) count, data);
+    } else {
+      Traits::getRegion(env, array, start, (jsize) count, data);
+    }
+    return !env->ExceptionCheck();
+  }
+
+  size_t chunk = options.critical_chunk_bytes / sizeof(T);
+  if (!chunk) {
+    chunk = 1;
+  }
+  for (size_t done = 0; done < count; done += chunk) {
+    size_t n = (count - done < chunk) ? (count - done) : chunk;
+    T* elements = (T*) env->GetPrimitiveArrayCritical(array, nullptr);
+    if (!elements) {
+      return false;
+    }
+    if (kToJava) {
+      memcpy(elements + start + done, data + done, n * sizeof(T));
+    } else {
+      memcpy(data + done, elements + start + done, n * sizeof(T));
+    }
+    env->ReleasePrimitiveArrayCritical(array, elements, kToJava ? 0 : JNI_ABORT);
+  }
+  return true;
+}
+
+} // namespace intl
+
+/**
+ * Copy count elements of data into array[start...]
+ * @return false with the java exception pending on failure
+ */
+template <class T>
+bool copyToJava(JNIEnv* env, typename PrimitiveArrayType<T>::array_type array, jsize start,
+                const T* data, size_t count, const ArrayTransferOptions& options = ArrayTransferOptions()) {
+  return intl::transferArray<T, true>(env, array, start, (T*) data, count, options);
+}
+
+/**
+ * Copy count elements of array[start...] into data
+ * @return false with the java exception pending on failure
+ */
+template <class T>
+bool copyFromJava(JNIEnv* env, typename PrimitiveArrayType<T>::array_type array, jsize start,
+                  T* data, size_t count, const ArrayTransferOptions& options = ArrayTransferOptions()) {
+  return intl::transferArray<T, false>(env, array, start, data, count, options);
+}
+
+/**
+ * @return local reference of a new java array holding values, null with the java exception pending on failure
+ */
+template <class T>
+typename PrimitiveArrayType<T>::array_type newJavaArray(JNIEnv* env, const std::vector<T>& values,
+                                                        const ArrayTransferOptions& options = ArrayTransferOptions()) {
+  typename PrimitiveArrayType<T>::array_type array = PrimitiveArrayType<T>::newArray(env, (jsize) values.size());
+  if (!array) {
+    return nullptr;
+  }
+  if (!copyToJava<T>(env, array, 0, values.data(), values.size(), options)) {
+    env->DeleteLocalRef(array);
+    return nullptr;
+  }
+  return array;
+}
+
+/**
+ * Replace the content of values with the whole java array
+ */
+template <class T>
+bool toVector(JNIEnv* env, typename PrimitiveArrayType<T>::array_type array, std::vector<T>* values,
+              const ArrayTransferOptions& options = ArrayTransferOptions()) {
+  values->resize((size_t) env->GetArrayLength(array));
+  return copyFromJava<T>(env, array, 0, values->data(), values->size(), options);
+}
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_ARRAY_TRANSFER_H_
@@ -0,0 +1,85 @@
+/**
+ * @file	builtin_library.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/26
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_BUILTIN_LIBRARY_H_
+#define JCU_JVM_BUILTIN_LIBRARY_H_
+
+#include <string>
+#include <vector>
+
+#include <jni.h>
+
+namespace jcu {
+namespace jvm {
+
+typedef jint (JNICALL *JniOnLoadFn)(JavaVM* vm, void* reserved);
+typedef void (JNICALL *JniOnUnloadFn)(JavaVM* vm, void* reserved);
+
+/**
+ * JNI libraries statically linked into the host executable (JDK 8+, JEP 178)
+ *
+ * System.loadLibrary("foo") resolves to JNI_OnLoad_foo exported by the
+ * process image without any dlopen. The entry points must be exported
+ * from the executable (ENABLE_EXPORTS / -rdynamic on unix) and
+ * JNI_OnLoad_foo must return JNI_VERSION_1_8 or later.
+ * OsHandler::loadLibrary() opens a registered name as a builtin handle.
+ */
+class BuiltinLibraries {
+ public:
+  struct Library {
+    std::string name;
+    JniOnLoadFn on_load;
+    JniOnUnloadFn on_unload;
+  };
+
+  /**
+   * @param name library name as given to System.loadLibrary
+   * @param on_unload may be null
+   * @return false if name is already registered
+   */
+  static bool add(const char* name, JniOnLoadFn on_load, JniOnUnloadFn on_unload = nullptr);
+
+  static bool find(const char* name, Library* library = nullptr);
+
+  static std::vector<std::string> names();
+
+  /**
+   * @return "JNI_OnLoad_<name>"
+   */
+  static std::string onLoadSymbol(const char* name);
+
+  /**
+   * @return "JNI_OnUnload_<name>"
+   */
+  static std::string onUnloadSymbol(const char* name);
+};
+
+/**
+ * Export JNI_OnLoad_NAME / JNI_OnUnload_NAME and register them.
+ * Use it in a translation unit of the executable itself, objects of a
+ * static archive that are not referenced are dropped by the linker.
+ *
+ * JCU_JVM_BUILTIN_JNI_LIBRARY(codec, codecOnLoad, nullptr);
+ */
+#define JCU_JVM_BUILTIN_JNI_LIBRARY(NAME, ON_LOAD, ON_UNLOAD) \
+  extern "C" JNIEXPORT jint JNICALL JNI_OnLoad_ ## NAME(JavaVM* vm, void* reserved) { \
+    ::jcu::jvm::JniOnLoadFn fn = ON_LOAD; \
+    return fn(vm, reserved); \
+  } \
+  extern "C" JNIEXPORT void JNICALL JNI_OnUnload_ ## NAME(JavaVM* vm, void* reserved) { \
+    ::jcu::jvm::JniOnUnloadFn fn = ON_UNLOAD; \
+    if (fn) fn(vm, reserved); \
+  } \
+  static const bool jcu_jvm_builtin_ ## NAME ## _registered_ = \
+      ::jcu::jvm::BuiltinLibraries::add(#NAME, &JNI_OnLoad_ ## NAME, &JNI_OnUnload_ ## NAME)
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_BUILTIN_LIBRARY_H_
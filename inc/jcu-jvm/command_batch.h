@@ -0,0 +1,233 @@
+/**
+ * @file	command_batch.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/27
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_COMMAND_BATCH_H_
+#define JCU_JVM_COMMAND_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <type_traits>
+#include <utility>
+
+#include <jni.h>
+
+#include "jni_signature.h"
+#include "java_exception.h"
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Many small java calls executed in one JNI upcall.
+ *
+ * Calls are packed into a direct buffer and run by
+ * net.jclab.jcu.jvm.CommandBatchDispatcher (java/src/main/java), which must
+ * be on the classpath. Results are written back into the same buffer.
+ * define() builds one method handle per op reading its slots straight from
+ * the buffer, so running a record neither allocates nor boxes.
+ * Not thread safe, use one batch per thread.
+ *
+ * Record layout (native byte order):
+ *   int32 op, int32 receiver ref index (-1 for static),
+ *   8 byte slot per argument, 8 byte result slot.
+ * Primitive slots hold the jvalue bits, object slots an index of the
+ * Object[] reference table passed along with the buffer.
+ */
+class CommandBatch {
+ public:
+  struct Options {
+    size_t buffer_size;
+    /**
+     * size of the reference table (receivers, object arguments and results)
+     */
+    jsize max_refs;
+
+    Options()
+        : buffer_size(64 * 1024), max_refs(1024) {}
+  };
+
+  typedef jint Op;
+
+  /**
+   * Op of a method of type F, add() converts the arguments to its parameter types
+   */
+  template <class F>
+  struct TypedOp {
+    Op op;
+
+    TypedOp(Op op = -1) : op(op) {}
+    operator Op() const {
+      return op;
+    }
+  };
+
+  virtual ~CommandBatch() {}
+
+  /**
+   * Define an operation of this batch
+   * @param signature method descriptor
+   * @return -1 with the java exception pending on failure
+   */
+  virtual Op define(JNIEnv* env, jclass clazz, const char* name, const char* signature, bool is_static) = 0;
+
+  template <class F>
+  TypedOp<F> defineMethod(JNIEnv* env, jclass clazz, const char* name) {
+    return TypedOp<F>(define(env, clazz, name, MethodSignature<F>::value.c_str(), false));
+  }
+
+  template <class F>
+  TypedOp<F> defineStaticMethod(JNIEnv* env, jclass clazz, const char* name) {
+    return TypedOp<F>(define(env, clazz, name, MethodSignature<F>::value.c_str(), true));
+  }
+
+  /**
+   * Append a call of op, the argument types must match its parameter types exactly.
+   * @param receiver null for a static op
+   * @return false if the buffer or the reference table is full (flush() first),
+   *         op is unknown or the arguments do not match
+   */
+  template <class... Args>
+  bool add(JNIEnv* env, Op op, jobject receiver, Args... args) {
+    return addArgs(env, op, receiver, args...);
+  }
+
+  template <class R, class... Params, class... Args>
+  bool add(JNIEnv* env, TypedOp<R(Params...)> op, jobject receiver, Args&&... args) {
+    static_assert(sizeof...(Params) == sizeof...(Args), "argument count does not match the op");
+    return addArgs<Params...>(env, op.op, receiver, std::forward<Args>(args)...);
+  }
+
+  /**
+   * Run the appended calls
+   * @param error null or the exception of the failing call
+   * @return number of calls completed, less than size() if a call threw
+   *         (the exception is cleared)
+   */
+  virtual size_t flush(JNIEnv* env, JavaError* error = nullptr) = 0;
+
+  /**
+   * Number of appended calls
+   */
+  virtual size_t size() const = 0;
+
+  /**
+   * Result of call index after flush(), until reset()
+   * Object results are new local references.
+   */
+  template <class T>
+  T result(JNIEnv* env, size_t index) const {
+    return readResult<T>(env, resultSlot(index));
+  }
+
+  /**
+   * Drop the appended calls and their results, releasing the references
+   * held by the reference table
+   */
+  virtual void reset(JNIEnv* env) = 0;
+
+  /**
+   * Delete the global references, must be called before VM::destroy()
+   */
+  virtual void destroy(JNIEnv* env) = 0;
+
+  static CommandBatch* create(const Options& options = Options());
+
+ protected:
+  /**
+   * @param arg_types descriptor char of every argument ('L' for references)
+   * @return the argument slots of the new record, null if it does not fit
+   *         or arg_types does not match the parameters of op
+   */
+  virtual uint8_t* appendRecord(JNIEnv* env, Op op, jobject receiver, const char* arg_types) = 0;
+  virtual void dropRecord(JNIEnv* env) = 0;
+
+  /**
+   * @return reference table index of obj, -1 if the table is full
+   */
+  virtual jint putRef(JNIEnv* env, jobject obj) = 0;
+  virtual jobject getRef(JNIEnv* env, jint index) const = 0;
+  virtual const uint8_t* resultSlot(size_t index) const = 0;
+
+ private:
+  template <class... Args>
+  bool addArgs(JNIEnv* env, Op op, jobject receiver, Args... args) {
+    const char arg_types[] = {argType<Args>()..., '\0'};
+    uint8_t* slots = appendRecord(env, op, receiver, arg_types);
+    if (!slots) {
+      return false;
+    }
+    bool ok = true;
+    int dummy[] = {0, (ok = ok && putArg(env, slots, args), slots += 8, 0)...};
+    (void) dummy;
+    if (!ok) {
+      dropRecord(env);
+    }
+    return ok;
+  }
+
+  template <class T>
+  static constexpr typename std::enable_if<std::is_arithmetic<T>::value, char>::type argType() {
+    return JniType<T>::descriptor().data[0];
+  }
+
+  template <class T>
+  static constexpr typename std::enable_if<!std::is_arithmetic<T>::value, char>::type argType() {
+    return 'L';
+  }
+
+  template <class T>
+  typename std::enable_if<std::is_arithmetic<T>::value, bool>::type putArg(JNIEnv* env, uint8_t* slot, T value) {
+    // the whole slot is read for long and double parameters
+    memset(slot, 0, 8);
+    memcpy(slot, &value, sizeof(T));
+    return true;
+  }
+
+  template <class T>
+  typename std::enable_if<!std::is_arithmetic<T>::value, bool>::type putArg(JNIEnv* env, uint8_t* slot, T value) {
+    jint index = putRef(env, static_cast<jobject>(value));
+    memcpy(slot, &index, sizeof(index));
+    return index >= 0;
+  }
+
+  template <class T>
+  typename std::enable_if<std::is_arithmetic<T>::value, T>::type readResult(JNIEnv* env, const uint8_t* slot) const {
+    T value = T();
+    if (slot) {
+      memcpy(&value, slot, sizeof(T));
+    }
+    return value;
+  }
+
+  template <class T>
+  typename std::enable_if<!std::is_arithmetic<T>::value, T>::type readResult(JNIEnv* env, const uint8_t* slot) const {
+    jint index = -1;
+    if (slot) {
+      memcpy(&index, slot, sizeof(index));
+    }
+    return fromRef<T>(getRef(env, index));
+  }
+
+  template <class T>
+  static typename std::enable_if<std::is_pointer<T>::value, T>::type fromRef(jobject obj) {
+    return static_cast<T>(obj);
+  }
+
+  template <class T>
+  static typename std::enable_if<!std::is_pointer<T>::value, T>::type fromRef(jobject obj) {
+    return T((decltype(T(nullptr).value)) obj);
+  }
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_COMMAND_BATCH_H_
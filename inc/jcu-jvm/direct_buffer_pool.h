@@ -0,0 +1,102 @@
+/**
+ * @file	direct_buffer_pool.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/22
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_DIRECT_BUFFER_POOL_H_
+#define JCU_JVM_DIRECT_BUFFER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <jni.h>
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Fixed size native buffers shared with java as direct ByteBuffers.
+ *
+ * Buffers are carved out of slabs allocated on demand. Every buffer gets its
+ * java.nio.ByteBuffer view (a global reference) once, when its slab is
+ * created, and is recycled through a lock-free free list afterwards.
+ * acquire() and release() may be called concurrently from any thread.
+ *
+ * Java code returns a buffer through a native method bound to
+ * nativeRelease(), e.g. registered as
+ * {"release", "(JLjava/nio/ByteBuffer;)V", (void*) DirectBufferPool::nativeRelease}
+ * and called with handle().
+ */
+class DirectBufferPool {
+ public:
+  struct Options {
+    size_t buffer_size;
+    size_t buffers_per_slab;
+    /**
+     * acquire() returns null once this many slabs are in use
+     */
+    size_t max_slabs;
+    /**
+     * reset position/limit of the ByteBuffer (Buffer.clear()) on acquire
+     */
+    bool clear_on_acquire;
+
+    Options()
+        : buffer_size(64 * 1024), buffers_per_slab(16), max_slabs(64), clear_on_acquire(true) {}
+  };
+
+  struct Buffer {
+    void* data;
+    size_t size;
+    /**
+     * global reference of the java.nio.ByteBuffer view of data, owned by the pool
+     */
+    jobject byte_buffer;
+  };
+
+  virtual ~DirectBufferPool() {}
+
+  /**
+   * @return null if the pool is exhausted or the slab could not be created
+   *         (a java exception may be pending)
+   */
+  virtual Buffer* acquire(JNIEnv* env) = 0;
+
+  virtual void release(Buffer* buffer) = 0;
+
+  /**
+   * Release by the ByteBuffer (or any view of the same memory)
+   * @return false if byte_buffer does not belong to this pool
+   */
+  virtual bool release(JNIEnv* env, jobject byte_buffer) = 0;
+
+  virtual size_t bufferSize() const = 0;
+
+  /**
+   * Delete the global references and free the slabs.
+   * Must be called before VM::destroy(), outstanding buffers become invalid.
+   */
+  virtual void destroy(JNIEnv* env) = 0;
+
+  jlong handle() {
+    return (jlong) (intptr_t) this;
+  }
+
+  static void JNICALL nativeRelease(JNIEnv* env, jclass /*clazz*/, jlong handle, jobject byte_buffer) {
+    DirectBufferPool* pool = (DirectBufferPool*) (intptr_t) handle;
+    if (pool) {
+      pool->release(env, byte_buffer);
+    }
+  }
+
+  static DirectBufferPool* create(const Options& options = Options());
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_DIRECT_BUFFER_POOL_H_
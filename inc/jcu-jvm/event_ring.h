@@ -0,0 +1,215 @@
+/**
+ * @file	event_ring.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/28
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_EVENT_RING_H_
+#define JCU_JVM_EVENT_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <jni.h>
+
+#include "vm.h"
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Ring of variable size records in native memory, shared with java as one
+ * direct ByteBuffer (net.jclab.jcu.jvm.EventRing, java/src/main/java).
+ *
+ * Either side can produce or consume, no JNI call is made per record.
+ * One consumer, one producer (or several with Options::multi_producer; java
+ * producers always claim with a CAS).
+ *
+ * Layout (native byte order):
+ *   [0]   int64 tail, claimed by producers
+ *   [128] int64 head, released by the consumer
+ *   [192] int32 closed
+ *   [256] records: int32 length (header included, 0 while not committed),
+ *         int32 type (kPaddingType at the end of the ring), payload,
+ *         aligned to 8 bytes. A record never wraps, the consumer zeroes
+ *         consumed records before releasing head.
+ */
+class EventRing {
+ public:
+  struct Options {
+    /**
+     * bytes of the record area, rounded up to a power of two
+     */
+    size_t capacity;
+    /**
+     * several native threads call write()
+     */
+    bool multi_producer;
+
+    Options()
+        : capacity(1024 * 1024), multi_producer(false) {}
+  };
+
+  static const size_t kTailOffset = 0;
+  static const size_t kHeadOffset = 128;
+  static const size_t kClosedOffset = 192;
+  static const size_t kHeaderSize = 256;
+  static const size_t kRecordHeaderSize = 8;
+  static const int32_t kPaddingType = -1;
+
+ protected:
+  uint8_t* memory_;
+  size_t capacity_;
+  bool multi_producer_;
+
+  EventRing() : memory_(nullptr), capacity_(0), multi_producer_(false) {}
+
+  std::atomic<int64_t>* position(size_t offset) const {
+    return reinterpret_cast<std::atomic<int64_t>*>(memory_ + offset);
+  }
+
+  std::atomic<int32_t>* lengthAt(size_t offset) const {
+    return reinterpret_cast<std::atomic<int32_t>*>(memory_ + kHeaderSize + offset);
+  }
+
+  static size_t align(size_t length) {
+    return (length + 7) & ~(size_t) 7;
+  }
+
+  void putRecord(size_t offset, int32_t type, const void* data, size_t size, int32_t length) {
+    uint8_t* record = memory_ + kHeaderSize + offset;
+    memcpy(record + 4, &type, sizeof(type));
+    if (size) {
+      memcpy(record + kRecordHeaderSize, data, size);
+    }
+    lengthAt(offset)->store(length, std::memory_order_release);
+  }
+
+ public:
+  virtual ~EventRing() {}
+
+  /**
+   * Global reference of the ByteBuffer over the whole ring (header included),
+   * pass it once to java
+   */
+  virtual jobject byteBuffer() const = 0;
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  /**
+   * largest payload write() accepts
+   */
+  size_t maxPayloadSize() const {
+    return capacity_ / 8 - kRecordHeaderSize;
+  }
+
+  /**
+   * Tell the other side no more records will be written
+   */
+  void close() {
+    reinterpret_cast<std::atomic<int32_t>*>(memory_ + kClosedOffset)->store(1, std::memory_order_release);
+  }
+
+  bool isClosed() const {
+    return reinterpret_cast<std::atomic<int32_t>*>(memory_ + kClosedOffset)->load(std::memory_order_acquire) != 0;
+  }
+
+  /**
+   * @param type >= 0
+   * @return false if the ring is full or size > maxPayloadSize()
+   */
+  bool write(int32_t type, const void* data, size_t size) {
+    if (size > maxPayloadSize() || type < 0) {
+      return false;
+    }
+    size_t record = align(kRecordHeaderSize + size);
+    std::atomic<int64_t>* tail_position = position(kTailOffset);
+    std::atomic<int64_t>* head_position = position(kHeadOffset);
+    int64_t head = head_position->load(std::memory_order_acquire);
+    int64_t tail = tail_position->load(std::memory_order_relaxed);
+    size_t offset;
+    size_t padding;
+    for (;;) {
+      offset = (size_t) tail & (capacity_ - 1);
+      padding = (record > capacity_ - offset) ? capacity_ - offset : 0;
+      size_t required = padding + record;
+      if ((size_t) (tail - head) + required > capacity_) {
+        head = head_position->load(std::memory_order_acquire);
+        if ((size_t) (tail - head) + required > capacity_) {
+          return false;
+        }
+      }
+      if (!multi_producer_) {
+        tail_position->store(tail + (int64_t) required, std::memory_order_relaxed);
+        break;
+      }
+      if (tail_position->compare_exchange_weak(tail, tail + (int64_t) required, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    if (padding) {
+      putRecord(offset, kPaddingType, nullptr, 0, (int32_t) padding);
+      offset = 0;
+    }
+    putRecord(offset, type, data, size, (int32_t) (kRecordHeaderSize + size));
+    return true;
+  }
+
+  /**
+   * Consume committed records, only one consumer may read at a time
+   * @param handler void(int32_t type, const void* data, size_t size),
+   *                data is only valid during the call
+   * @return number of records handled
+   */
+  template <class Handler>
+  size_t read(Handler&& handler, size_t max_records = (size_t) -1) {
+    std::atomic<int64_t>* head_position = position(kHeadOffset);
+    int64_t head = head_position->load(std::memory_order_relaxed);
+    size_t bytes = 0;
+    size_t count = 0;
+    while (count < max_records && bytes < capacity_) {
+      size_t offset = (size_t) (head + (int64_t) bytes) & (capacity_ - 1);
+      int32_t length = lengthAt(offset)->load(std::memory_order_acquire);
+      if (length <= 0) {
+        break;
+      }
+      const uint8_t* record = memory_ + kHeaderSize + offset;
+      int32_t type;
+      memcpy(&type, record + 4, sizeof(type));
+      if (type != kPaddingType) {
+        handler(type, (const void*) (record + kRecordHeaderSize), (size_t) length - kRecordHeaderSize);
+        count++;
+      }
+      bytes += align((size_t) length);
+    }
+    if (bytes) {
+      size_t offset = (size_t) head & (capacity_ - 1);
+      size_t first = (bytes < capacity_ - offset) ? bytes : capacity_ - offset;
+      memset(memory_ + kHeaderSize + offset, 0, first);
+      memset(memory_ + kHeaderSize, 0, bytes - first);
+      head_position->store(head + (int64_t) bytes, std::memory_order_release);
+    }
+    return count;
+  }
+
+  /**
+   * Allocate the ring and its ByteBuffer on the calling thread (attached if needed).
+   * The ring must outlive every java access to the buffer, delete it after
+   * the java side stopped and before VM::destroy().
+   * @return null on failure
+   */
+  static EventRing* create(VM* vm, const Options& options = Options());
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_EVENT_RING_H_
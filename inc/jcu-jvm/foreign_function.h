@@ -0,0 +1,127 @@
+/**
+ * @file	foreign_function.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/30
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_FOREIGN_FUNCTION_H_
+#define JCU_JVM_FOREIGN_FUNCTION_H_
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <jni.h>
+
+#include "jni_signature.h"
+#include "vm.h"
+
+#ifndef JNI_VERSION_21
+#define JCU_JVM_JNI_VERSION_21 0x00150000
+#else
+#define JCU_JVM_JNI_VERSION_21 JNI_VERSION_21
+#endif
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Plain C functions called from java through the Foreign Function & Memory
+ * API when the vm has it, through JNI otherwise.
+ *
+ * install() always registers the functions as static native methods of the
+ * owner class. With VM::foreignLinkerSupported() and
+ * net.jclab.jcu.jvm.ForeignBindings (java/src/main/java) reporting FFM, it
+ * also publishes their addresses so that
+ * ForeignBindings.downcall(lookup, name, type) returns a downcall handle
+ * without JNI transition instead of a handle to the native method.
+ *
+ * Parameters and results are java primitives (pointers as jlong on 64 bit
+ * platforms), java declares e.g. `static native long checksum(long address, int length);`
+ */
+class ForeignFunctions {
+ public:
+  struct Entry {
+    std::string name;
+    std::string descriptor;
+    void* fn;
+    /**
+     * call without thread state transition (Linker.Option.critical), for
+     * short functions that neither block nor call back into java
+     */
+    bool critical;
+    /**
+     * JNI trampoline of fn, registered as the native method
+     */
+    void* jni_fn;
+  };
+
+ private:
+  std::vector<Entry> entries_;
+
+  template <class F, F* Fn>
+  struct JniEntry;
+
+  template <class R, class... Args, R (*Fn)(Args...)>
+  struct JniEntry<R(Args...), Fn> {
+    static R JNICALL invoke(JNIEnv*, jclass, Args... args) {
+      return Fn(args...);
+    }
+  };
+
+ public:
+  /**
+   * Bind Fn, every function gets its own JNI trampoline
+   *
+   * functions.bind<decltype(checksum), &checksum>("checksum", true);
+   */
+  template <class F, F* Fn>
+  ForeignFunctions& bind(const char* name, bool critical = false) {
+    static_assert(std::is_function<F>::value, "F must be a function type");
+    Entry entry;
+    entry.name = name;
+    entry.descriptor = MethodSignature<F>::value.c_str();
+    entry.fn = (void*) Fn;
+    entry.critical = critical;
+    entry.jni_fn = (void*) &JniEntry<F, Fn>::invoke;
+    entries_.emplace_back(std::move(entry));
+    return *this;
+  }
+
+  const std::vector<Entry>& entries() const {
+    return entries_;
+  }
+
+  /**
+   * @param owner class declaring the native methods
+   * @return the result of VM::registerNatives(), or JNI_ERR with the java
+   *         exception pending if the addresses could not be published
+   */
+  jint install(VM* vm, JNIEnv* env, jclass owner) const;
+
+  /**
+   * Whether ForeignBindings uses FFM in this vm (false before JDK 22 or if
+   * the class is not on the classpath)
+   */
+  static bool available(VM* vm, JNIEnv* env);
+
+  /**
+   * Function pointer of an upcall stub created by java with
+   * ForeignBindings.registerUpcall(name, target)
+   * @return null without FFM, if name is not registered or its type is not F
+   */
+  template <class F>
+  static F* upcall(JNIEnv* env, const char* name) {
+    return reinterpret_cast<F*>(upcallAddress(env, name, MethodSignature<F>::value.c_str()));
+  }
+
+  static void* upcallAddress(JNIEnv* env, const char* name, const char* descriptor);
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_FOREIGN_FUNCTION_H_
@@ -0,0 +1,80 @@
+/**
+ * @file	handle_table.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/28
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_HANDLE_TABLE_H_
+#define JCU_JVM_HANDLE_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <jni.h>
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Integer handles of long lived java objects.
+ *
+ * Objects are stored in java Object[] chunks, one global reference per chunk
+ * instead of one per object. A handle is the slot index and the slot
+ * generation, so a handle of a removed object never resolves to the object
+ * that reuses its slot. get() is lock-free, add() and remove() take a short lock.
+ *
+ * The table of a VM (VM::handles()) is cleared by VM::destroy().
+ */
+class HandleTable {
+ public:
+  /**
+   * generation in the upper 32 bits, slot index + 1 in the lower 32 bits, 0 is never valid
+   */
+  typedef uint64_t Handle;
+
+  struct Options {
+    /**
+     * slots per Object[] chunk
+     */
+    uint32_t chunk_size;
+    uint32_t max_chunks;
+
+    Options()
+        : chunk_size(1024), max_chunks(4096) {}
+  };
+
+  virtual ~HandleTable() {}
+
+  /**
+   * @return 0 if the table is full or the chunk could not be created
+   */
+  virtual Handle add(JNIEnv* env, jobject obj) = 0;
+
+  /**
+   * @return new local reference, null for a stale or invalid handle
+   */
+  virtual jobject get(JNIEnv* env, Handle handle) const = 0;
+
+  /**
+   * @return false for a stale or invalid handle
+   */
+  virtual bool remove(JNIEnv* env, Handle handle) = 0;
+
+  virtual size_t size() const = 0;
+
+  /**
+   * Remove every object and release the chunks, all handles become stale.
+   * Must not overlap with the other methods.
+   */
+  virtual void clear(JNIEnv* env) = 0;
+
+  static HandleTable* create(const Options& options = Options());
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_HANDLE_TABLE_H_
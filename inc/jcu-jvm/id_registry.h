@@ -0,0 +1,128 @@
+/**
+ * @file	id_registry.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/11
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_ID_REGISTRY_H_
+#define JCU_JVM_ID_REGISTRY_H_
+
+#include <atomic>
+
+#include <jni.h>
+
+#include "jni_signature.h"
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Declare a class key
+ *
+ * JCU_JVM_CLASS_KEY(JavaLangSystem, "java/lang/System");
+ */
+#define JCU_JVM_CLASS_KEY(KEY, CLASS_NAME) \
+  struct KEY { \
+    static const char* name() { return CLASS_NAME; } \
+    static constexpr auto descriptor() { return ::jcu::jvm::makeConstString("L" CLASS_NAME ";"); } \
+  }
+
+#define JCU_JVM_MEMBER_KEY_(KEY, CLASS_KEY, MEMBER_NAME, SIGNATURE, KIND) \
+  struct KEY { \
+    typedef CLASS_KEY class_key; \
+    static const ::jcu::jvm::IdRegistry::Kind kind = ::jcu::jvm::IdRegistry::KIND; \
+    static const char* name() { return MEMBER_NAME; } \
+    static const char* signature() { return SIGNATURE; } \
+  }
+
+/**
+ * Declare a method / field key
+ *
+ * JCU_JVM_STATIC_METHOD_KEY(JavaLangSystemExit, JavaLangSystem, "exit", "(I)V");
+ */
+#define JCU_JVM_METHOD_KEY(KEY, CLASS_KEY, NAME, SIGNATURE) JCU_JVM_MEMBER_KEY_(KEY, CLASS_KEY, NAME, SIGNATURE, kMethod)
+#define JCU_JVM_STATIC_METHOD_KEY(KEY, CLASS_KEY, NAME, SIGNATURE) JCU_JVM_MEMBER_KEY_(KEY, CLASS_KEY, NAME, SIGNATURE, kStaticMethod)
+#define JCU_JVM_FIELD_KEY(KEY, CLASS_KEY, NAME, SIGNATURE) JCU_JVM_MEMBER_KEY_(KEY, CLASS_KEY, NAME, SIGNATURE, kField)
+#define JCU_JVM_STATIC_FIELD_KEY(KEY, CLASS_KEY, NAME, SIGNATURE) JCU_JVM_MEMBER_KEY_(KEY, CLASS_KEY, NAME, SIGNATURE, kStaticField)
+
+/**
+ * Process wide jclass / jmethodID / jfieldID registry.
+ *
+ * Every key owns one static slot which is resolved on first use and read with
+ * a single atomic load afterwards. Classes are held as global references.
+ * VM::destroy() releases the global references and clears all slots, so the
+ * next VM resolves them again.
+ *
+ * On failure nullptr is returned and the java exception
+ * (NoClassDefFoundError, NoSuchMethodError, ...) is left pending.
+ */
+class IdRegistry {
+ public:
+  enum Kind {
+    kClass = 0,
+    kMethod,
+    kStaticMethod,
+    kField,
+    kStaticField,
+  };
+
+  template <class K>
+  struct Slot {
+    static std::atomic<void*> value;
+  };
+
+  template <class ClassKey>
+  static jclass getClass(JNIEnv* env) {
+    void* value = Slot<ClassKey>::value.load(std::memory_order_acquire);
+    if (!value) {
+      value = resolveClass(env, &Slot<ClassKey>::value, ClassKey::name());
+    }
+    return (jclass) value;
+  }
+
+  template <class MethodKey>
+  static jmethodID getMethod(JNIEnv* env) {
+    static_assert(MethodKey::kind == kMethod || MethodKey::kind == kStaticMethod, "not a method key");
+    return (jmethodID) getMember<MethodKey>(env);
+  }
+
+  template <class FieldKey>
+  static jfieldID getField(JNIEnv* env) {
+    static_assert(FieldKey::kind == kField || FieldKey::kind == kStaticField, "not a field key");
+    return (jfieldID) getMember<FieldKey>(env);
+  }
+
+  /**
+   * Release all resolved ids. Called by VM::destroy().
+   * @param env null to drop the global references without deleting them
+   */
+  static void reset(JNIEnv* env);
+
+ private:
+  template <class K>
+  static void* getMember(JNIEnv* env) {
+    void* value = Slot<K>::value.load(std::memory_order_acquire);
+    if (!value) {
+      jclass clazz = getClass<typename K::class_key>(env);
+      if (!clazz) {
+        return nullptr;
+      }
+      value = resolveMember(env, &Slot<K>::value, K::kind, clazz, K::name(), K::signature());
+    }
+    return value;
+  }
+
+  static void* resolveClass(JNIEnv* env, std::atomic<void*>* slot, const char* name);
+  static void* resolveMember(JNIEnv* env, std::atomic<void*>* slot, Kind kind, jclass clazz, const char* name, const char* signature);
+};
+
+template <class K>
+std::atomic<void*> IdRegistry::Slot<K>::value(nullptr);
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_ID_REGISTRY_H_
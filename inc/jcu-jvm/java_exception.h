@@ -0,0 +1,240 @@
+/**
+ * @file	java_exception.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/27
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_JAVA_EXCEPTION_H_
+#define JCU_JVM_JAVA_EXCEPTION_H_
+
+#include <string>
+#include <utility>
+
+#include <jni.h>
+
+#ifndef JCU_JVM_EXCEPTIONS
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define JCU_JVM_EXCEPTIONS 1
+#else
+#define JCU_JVM_EXCEPTIONS 0
+#endif
+#endif
+
+#if JCU_JVM_EXCEPTIONS
+#include <stdexcept>
+#endif
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Description of a java exception taken from a thread
+ */
+struct JavaError {
+  /**
+   * binary name ("java.lang.IllegalStateException")
+   */
+  std::string class_name;
+  std::string message;
+  /**
+   * printStackTrace() output, only filled with kDetailStack
+   */
+  std::string stack_trace;
+
+  /**
+   * "<class_name>: <message>"
+   */
+  std::string toString() const;
+};
+
+class JavaExceptions {
+ public:
+  enum Detail {
+    /**
+     * clear only
+     */
+    kDetailNone = 0,
+    kDetailMessage,
+    kDetailStack,
+  };
+
+  /**
+   * One ExceptionCheck, no local reference
+   */
+  static bool pending(JNIEnv* env) {
+    return env->ExceptionCheck() == JNI_TRUE;
+  }
+
+  /**
+   * Clear the pending exception of the calling thread and describe it.
+   * The description goes through cached ids (see IdRegistry) and only
+   * runs when an exception was pending.
+   * @param error null or filled according to detail
+   * @return false if no exception was pending
+   */
+  static bool take(JNIEnv* env, JavaError* error = nullptr, Detail detail = kDetailMessage);
+
+  /**
+   * Describe throwable, nothing must be pending.
+   * An exception raised while describing is cleared and leaves the
+   * remaining fields empty.
+   */
+  static void describe(JNIEnv* env, jthrowable throwable, JavaError* error, Detail detail = kDetailMessage);
+};
+
+#if JCU_JVM_EXCEPTIONS
+class JavaException : public std::runtime_error {
+ private:
+  JavaError error_;
+
+ public:
+  explicit JavaException(JavaError error)
+      : std::runtime_error(error.toString()), error_(std::move(error)) {}
+
+  const JavaError& error() const {
+    return error_;
+  }
+};
+#endif
+
+/**
+ * Value of a java call, or the exception it threw (already cleared)
+ */
+template <class T>
+class JavaResult {
+ private:
+  T value_;
+  bool ok_;
+  JavaError error_;
+
+ public:
+  JavaResult(T value) : value_(std::move(value)), ok_(true) {}
+  JavaResult(JavaError error) : value_(), ok_(false), error_(std::move(error)) {}
+
+  bool ok() const {
+    return ok_;
+  }
+
+  explicit operator bool() const {
+    return ok_;
+  }
+
+  const T& value() const {
+    return value_;
+  }
+
+  T valueOr(T fallback) const {
+    return ok_ ? value_ : fallback;
+  }
+
+  const JavaError& error() const {
+    return error_;
+  }
+
+#if JCU_JVM_EXCEPTIONS
+  /**
+   * @throw JavaException
+   */
+  T orThrow() const {
+    if (!ok_) {
+      throw JavaException(error_);
+    }
+    return value_;
+  }
+#endif
+};
+
+template <>
+class JavaResult<void> {
+ private:
+  bool ok_;
+  JavaError error_;
+
+ public:
+  JavaResult() : ok_(true) {}
+  JavaResult(JavaError error) : ok_(false), error_(std::move(error)) {}
+
+  bool ok() const {
+    return ok_;
+  }
+
+  explicit operator bool() const {
+    return ok_;
+  }
+
+  const JavaError& error() const {
+    return error_;
+  }
+
+#if JCU_JVM_EXCEPTIONS
+  void orThrow() const {
+    if (!ok_) {
+      throw JavaException(error_);
+    }
+  }
+#endif
+};
+
+namespace intl {
+
+template <class R>
+struct CheckedCall {
+  template <class Fn>
+  static JavaResult<R> run(JNIEnv* env, Fn&& fn, JavaExceptions::Detail detail) {
+    R value = fn();
+    if (!env->ExceptionCheck()) {
+      return JavaResult<R>(std::move(value));
+    }
+    JavaError error;
+    JavaExceptions::take(env, &error, detail);
+    return JavaResult<R>(std::move(error));
+  }
+};
+
+template <>
+struct CheckedCall<void> {
+  template <class Fn>
+  static JavaResult<void> run(JNIEnv* env, Fn&& fn, JavaExceptions::Detail detail) {
+    fn();
+    if (!env->ExceptionCheck()) {
+      return JavaResult<void>();
+    }
+    JavaError error;
+    JavaExceptions::take(env, &error, detail);
+    return JavaResult<void>(std::move(error));
+  }
+};
+
+} // namespace intl
+
+/**
+ * Run fn (JNI calls on env) and check for an exception once afterwards.
+ * A returned local reference is not released when the call failed.
+ *
+ * JavaResult<jboolean> started = checkedCall(env, [&] { return DaemonStart::call(env, daemon); });
+ * if (!started) log(started.error().toString());
+ */
+template <class Fn>
+auto checkedCall(JNIEnv* env, Fn&& fn, JavaExceptions::Detail detail = JavaExceptions::kDetailMessage)
+    -> JavaResult<decltype(fn())> {
+  return intl::CheckedCall<decltype(fn())>::run(env, std::forward<Fn>(fn), detail);
+}
+
+#if JCU_JVM_EXCEPTIONS
+/**
+ * checkedCall() throwing JavaException instead of returning the error
+ */
+template <class Fn>
+auto throwingCall(JNIEnv* env, Fn&& fn, JavaExceptions::Detail detail = JavaExceptions::kDetailMessage)
+    -> decltype(fn()) {
+  return checkedCall(env, std::forward<Fn>(fn), detail).orThrow();
+}
+#endif
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_JAVA_EXCEPTION_H_
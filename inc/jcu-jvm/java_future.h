@@ -0,0 +1,154 @@
+/**
+ * @file	java_future.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/29
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_JAVA_FUTURE_H_
+#define JCU_JVM_JAVA_FUTURE_H_
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include <jni.h>
+
+#include "vm.h"
+
+#if defined(__has_include)
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define JCU_JVM_COROUTINES 1
+#endif
+#endif
+
+#ifndef JCU_JVM_COROUTINES
+#define JCU_JVM_COROUTINES 0
+#endif
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Value or exception of a completed CompletionStage, held as global references.
+ * Copies share the references, the last one deletes them on an attached thread.
+ */
+class FutureOutcome {
+ private:
+  struct Refs {
+    VM* vm;
+    jobject value;
+    jthrowable error;
+
+    ~Refs();
+  };
+
+  std::shared_ptr<Refs> refs_;
+
+ public:
+  FutureOutcome() {}
+
+  /**
+   * @param value local reference or null
+   * @param error local reference or null
+   */
+  FutureOutcome(VM* vm, JNIEnv* env, jobject value, jthrowable error);
+
+  bool ok() const {
+    return refs_ && !refs_->error;
+  }
+
+  /**
+   * global reference, valid while this outcome lives
+   */
+  jobject value() const {
+    return refs_ ? refs_->value : nullptr;
+  }
+
+  /**
+   * global reference, null if the stage completed normally
+   */
+  jthrowable error() const {
+    return refs_ ? refs_->error : nullptr;
+  }
+};
+
+class JavaFutures {
+ public:
+  /**
+   * Runs a completion somewhere else, e.g. on a VmExecutor worker
+   */
+  typedef std::function<void(std::function<void()>)> Executor;
+  typedef std::function<void(FutureOutcome)> Callback;
+
+  /**
+   * Call callback once stage (a java.util.concurrent.CompletionStage) completes,
+   * without blocking any thread.
+   *
+   * Completion goes through net.jclab.jcu.jvm.NativeCompletion
+   * (java/src/main/java, registered through VM::registerNatives() on first
+   * use) and is handed to executor from the completing java thread. An
+   * empty executor runs callback on that java thread. If the stage is
+   * already complete this happens before whenComplete() returns.
+   *
+   * @return false with the java exception pending if the callback could not be attached
+   */
+  static bool whenComplete(VM* vm, JNIEnv* env, jobject stage, Executor executor, Callback callback);
+};
+
+#if JCU_JVM_COROUTINES
+/**
+ * co_await support, resumes the coroutine on the executor
+ *
+ * FutureOutcome result = co_await awaitFuture(vm, env, future, executor);
+ */
+class FutureAwaiter {
+ private:
+  VM* vm_;
+  JNIEnv* env_;
+  jobject stage_;
+  JavaFutures::Executor executor_;
+  FutureOutcome outcome_;
+
+ public:
+  FutureAwaiter(VM* vm, JNIEnv* env, jobject stage, JavaFutures::Executor executor)
+      : vm_(vm), env_(env), stage_(stage), executor_(std::move(executor)) {}
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    FutureOutcome* outcome = &outcome_;
+    bool attached = JavaFutures::whenComplete(vm_, env_, stage_, executor_, [outcome, handle](FutureOutcome result) {
+      *outcome = std::move(result);
+      handle.resume();
+    });
+    // the coroutine may already run on another thread, members must not be touched from here on
+    if (attached) {
+      return true;
+    }
+    jthrowable error = env_->ExceptionOccurred();
+    env_->ExceptionClear();
+    outcome_ = FutureOutcome(vm_, env_, nullptr, error);
+    env_->DeleteLocalRef(error);
+    return false;
+  }
+
+  FutureOutcome await_resume() {
+    return std::move(outcome_);
+  }
+};
+
+inline FutureAwaiter awaitFuture(VM* vm, JNIEnv* env, jobject stage, JavaFutures::Executor executor = nullptr) {
+  return FutureAwaiter(vm, env, stage, std::move(executor));
+}
+#endif
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_JAVA_FUTURE_H_
@@ -0,0 +1,225 @@
+/**
+ * @file	jni_signature.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/12
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_JNI_SIGNATURE_H_
+#define JCU_JVM_JNI_SIGNATURE_H_
+
+#include <stddef.h>
+
+#include <jni.h>
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Fixed size string usable in constant expressions
+ */
+template <size_t N>
+struct ConstString {
+  char data[N + 1];
+
+  constexpr size_t size() const {
+    return N;
+  }
+
+  constexpr const char* c_str() const {
+    return data;
+  }
+};
+
+template <size_t N>
+constexpr ConstString<N - 1> makeConstString(const char (&str)[N]) {
+  ConstString<N - 1> result{};
+  for (size_t i = 0; i < N - 1; i++) {
+    result.data[i] = str[i];
+  }
+  return result;
+}
+
+constexpr ConstString<0> concatConstString() {
+  return ConstString<0>{};
+}
+
+template <size_t N>
+constexpr ConstString<N> concatConstString(const ConstString<N>& a) {
+  return a;
+}
+
+template <size_t A, size_t B, class... Rest>
+constexpr auto concatConstString(const ConstString<A>& a, const ConstString<B>& b, const Rest&... rest) {
+  ConstString<A + B> joined{};
+  for (size_t i = 0; i < A; i++) {
+    joined.data[i] = a.data[i];
+  }
+  for (size_t i = 0; i < B; i++) {
+    joined.data[A + i] = b.data[i];
+  }
+  return concatConstString(joined, rest...);
+}
+
+/**
+ * Typed object reference, described as "L<class name>;"
+ * @tparam ClassKey key declared with JCU_JVM_CLASS_KEY
+ */
+template <class ClassKey>
+struct Object {
+  jobject value;
+
+  Object(jobject v = nullptr) : value(v) {}
+  operator jobject() const {
+    return value;
+  }
+};
+
+/**
+ * Typed object array, described as "[<element descriptor>"
+ */
+template <class Element>
+struct Array {
+  jobjectArray value;
+
+  Array(jobjectArray v = nullptr) : value(v) {}
+  operator jobjectArray() const {
+    return value;
+  }
+};
+
+/**
+ * Mapping of a C++ type to its JNI descriptor and Call*MethodA variant
+ */
+template <class T>
+struct JniType;
+
+#define JCU_JVM_JNI_PRIMITIVE_TYPE_(TYPE, NAME, DESCRIPTOR, MEMBER) \
+  template <> \
+  struct JniType<TYPE> { \
+    static constexpr ConstString<1> descriptor() { return makeConstString(DESCRIPTOR); } \
+    static jvalue toJvalue(TYPE v) { jvalue r; r.MEMBER = v; return r; } \
+    static TYPE call(JNIEnv* env, jobject obj, jmethodID method, const jvalue* args) { \
+      return env->Call ## NAME ## MethodA(obj, method, args); \
+    } \
+    static TYPE callStatic(JNIEnv* env, jclass clazz, jmethodID method, const jvalue* args) { \
+      return env->CallStatic ## NAME ## MethodA(clazz, method, args); \
+    } \
+  }
+
+JCU_JVM_JNI_PRIMITIVE_TYPE_(jboolean, Boolean, "Z", z);
+JCU_JVM_JNI_PRIMITIVE_TYPE_(jbyte, Byte, "B", b);
+JCU_JVM_JNI_PRIMITIVE_TYPE_(jchar, Char, "C", c);
+JCU_JVM_JNI_PRIMITIVE_TYPE_(jshort, Short, "S", s);
+JCU_JVM_JNI_PRIMITIVE_TYPE_(jint, Int, "I", i);
+JCU_JVM_JNI_PRIMITIVE_TYPE_(jlong, Long, "J", j);
+JCU_JVM_JNI_PRIMITIVE_TYPE_(jfloat, Float, "F", f);
+JCU_JVM_JNI_PRIMITIVE_TYPE_(jdouble, Double, "D", d);
+
+#undef JCU_JVM_JNI_PRIMITIVE_TYPE_
+
+template <>
+struct JniType<void> {
+  static constexpr ConstString<1> descriptor() { return makeConstString("V"); }
+  static void call(JNIEnv* env, jobject obj, jmethodID method, const jvalue* args) {
+    env->CallVoidMethodA(obj, method, args);
+  }
+  static void callStatic(JNIEnv* env, jclass clazz, jmethodID method, const jvalue* args) {
+    env->CallStaticVoidMethodA(clazz, method, args);
+  }
+};
+
+template <class T>
+struct JniObjectType {
+  static jvalue toJvalue(T v) {
+    jvalue r;
+    r.l = (jobject) v;
+    return r;
+  }
+  static T call(JNIEnv* env, jobject obj, jmethodID method, const jvalue* args) {
+    return T((decltype(T(nullptr).value)) env->CallObjectMethodA(obj, method, args));
+  }
+  static T callStatic(JNIEnv* env, jclass clazz, jmethodID method, const jvalue* args) {
+    return T((decltype(T(nullptr).value)) env->CallStaticObjectMethodA(clazz, method, args));
+  }
+};
+
+template <class T>
+struct JniRefType {
+  static jvalue toJvalue(T v) {
+    jvalue r;
+    r.l = v;
+    return r;
+  }
+  static T call(JNIEnv* env, jobject obj, jmethodID method, const jvalue* args) {
+    return (T) env->CallObjectMethodA(obj, method, args);
+  }
+  static T callStatic(JNIEnv* env, jclass clazz, jmethodID method, const jvalue* args) {
+    return (T) env->CallStaticObjectMethodA(clazz, method, args);
+  }
+};
+
+#define JCU_JVM_JNI_REF_TYPE_(TYPE, DESCRIPTOR) \
+  template <> \
+  struct JniType<TYPE> : JniRefType<TYPE> { \
+    static constexpr auto descriptor() { return makeConstString(DESCRIPTOR); } \
+  }
+
+JCU_JVM_JNI_REF_TYPE_(jobject, "Ljava/lang/Object;");
+JCU_JVM_JNI_REF_TYPE_(jstring, "Ljava/lang/String;");
+JCU_JVM_JNI_REF_TYPE_(jclass, "Ljava/lang/Class;");
+JCU_JVM_JNI_REF_TYPE_(jthrowable, "Ljava/lang/Throwable;");
+JCU_JVM_JNI_REF_TYPE_(jobjectArray, "[Ljava/lang/Object;");
+JCU_JVM_JNI_REF_TYPE_(jbooleanArray, "[Z");
+JCU_JVM_JNI_REF_TYPE_(jbyteArray, "[B");
+JCU_JVM_JNI_REF_TYPE_(jcharArray, "[C");
+JCU_JVM_JNI_REF_TYPE_(jshortArray, "[S");
+JCU_JVM_JNI_REF_TYPE_(jintArray, "[I");
+JCU_JVM_JNI_REF_TYPE_(jlongArray, "[J");
+JCU_JVM_JNI_REF_TYPE_(jfloatArray, "[F");
+JCU_JVM_JNI_REF_TYPE_(jdoubleArray, "[D");
+
+#undef JCU_JVM_JNI_REF_TYPE_
+
+template <class ClassKey>
+struct JniType<Object<ClassKey>> : JniObjectType<Object<ClassKey>> {
+  static constexpr auto descriptor() { return ClassKey::descriptor(); }
+};
+
+template <class Element>
+struct JniType<Array<Element>> : JniObjectType<Array<Element>> {
+  static constexpr auto descriptor() { return concatConstString(makeConstString("["), JniType<Element>::descriptor()); }
+};
+
+/**
+ * Method descriptor generated from a function type
+ *
+ * MethodSignature<jboolean(jstring, Array<jstring>)>::value.c_str()
+ *   == "(Ljava/lang/String;[Ljava/lang/String;)Z"
+ */
+template <class F>
+struct MethodSignature;
+
+template <class R, class... Args>
+struct MethodSignature<R(Args...)> {
+  static constexpr auto build() {
+    return concatConstString(
+        makeConstString("("),
+        JniType<Args>::descriptor()...,
+        makeConstString(")"),
+        JniType<R>::descriptor());
+  }
+
+  typedef decltype(build()) type;
+  static constexpr type value = build();
+};
+
+template <class R, class... Args>
+constexpr typename MethodSignature<R(Args...)>::type MethodSignature<R(Args...)>::value;
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_JNI_SIGNATURE_H_
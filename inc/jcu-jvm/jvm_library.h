@@ -47,6 +47,12 @@ class JvmLibrary {
 
   virtual int load(const JvmLibraryPathInfo& path_info, bool jsig_load = false) = 0;
 
+  /**
+   * Timing of the last load(): find_jvm_library (taken from path_info),
+   * load_jsig, load_jvm and resolve_symbols
+   */
+  virtual const StartupTrace& getStartupTrace() const = 0;
+
   static JvmLibrary* create(PointerRef<OsHandler> os_handler);
 };
 
@@ -0,0 +1,239 @@
+/**
+ * @file	local_ref.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/26
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_LOCAL_REF_H_
+#define JCU_JVM_LOCAL_REF_H_
+
+#include <atomic>
+
+#include <jni.h>
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Debug accounting of LocalRef handles (disabled by default).
+ *
+ * When enabled every thread counts its live LocalRef handles, and
+ * LocalFrame / LocalRefLeakCheck report handles left over at their end
+ * through the leak handler (stderr by default). Raw jobject locals are not
+ * seen, run the vm with -Xcheck:jni for those.
+ */
+class LocalRefDebug {
+ public:
+  typedef void (*LeakHandler)(const char* message, long count);
+
+ private:
+  static std::atomic<bool> enabled_;
+
+ public:
+  static void setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  static bool isEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @param handler null restores the stderr handler
+   */
+  static void setLeakHandler(LeakHandler handler);
+
+  /**
+   * live LocalRef handles of the calling thread (0 when disabled)
+   */
+  static long outstanding();
+
+  static void track(long delta);
+  static void report(const char* message, long count);
+};
+
+/**
+ * Owning local reference, deleted when it goes out of scope
+ *
+ * LocalRef<jstring> name(env, env->NewStringUTF("x"));
+ */
+template <class T>
+class LocalRef {
+ private:
+  JNIEnv* env_;
+  T ref_;
+  bool tracked_;
+
+  void track(T ref) {
+    tracked_ = ref && LocalRefDebug::isEnabled();
+    if (tracked_) {
+      LocalRefDebug::track(1);
+    }
+  }
+
+ public:
+  LocalRef()
+      : env_(nullptr), ref_(nullptr), tracked_(false) {}
+
+  LocalRef(JNIEnv* env, T ref)
+      : env_(env), ref_(ref) {
+    track(ref);
+  }
+
+  LocalRef(LocalRef&& other)
+      : env_(other.env_), ref_(other.ref_), tracked_(other.tracked_) {
+    other.ref_ = nullptr;
+    other.tracked_ = false;
+  }
+
+  LocalRef& operator=(LocalRef&& other) {
+    if (this != &other) {
+      reset();
+      env_ = other.env_;
+      ref_ = other.ref_;
+      tracked_ = other.tracked_;
+      other.ref_ = nullptr;
+      other.tracked_ = false;
+    }
+    return *this;
+  }
+
+  LocalRef(const LocalRef&) = delete;
+  LocalRef& operator=(const LocalRef&) = delete;
+
+  ~LocalRef() {
+    reset();
+  }
+
+  void reset() {
+    if (ref_) {
+      env_->DeleteLocalRef(ref_);
+      ref_ = nullptr;
+    }
+    if (tracked_) {
+      LocalRefDebug::track(-1);
+      tracked_ = false;
+    }
+  }
+
+  void reset(JNIEnv* env, T ref) {
+    reset();
+    env_ = env;
+    ref_ = ref;
+    track(ref);
+  }
+
+  /**
+   * Give up ownership without deleting the reference
+   */
+  T release() {
+    T ref = ref_;
+    ref_ = nullptr;
+    if (tracked_) {
+      LocalRefDebug::track(-1);
+      tracked_ = false;
+    }
+    return ref;
+  }
+
+  T get() const {
+    return ref_;
+  }
+
+  operator T() const {
+    return ref_;
+  }
+
+  explicit operator bool() const {
+    return ref_ != nullptr;
+  }
+};
+
+/**
+ * PushLocalFrame / PopLocalFrame scope
+ *
+ * LocalFrame frame(env, 32);
+ * jobject result = ...;
+ * return frame.pop(result); // result survives as a local of the outer frame
+ */
+class LocalFrame {
+ private:
+  JNIEnv* env_;
+  bool pushed_;
+  long outstanding_;
+
+ public:
+  explicit LocalFrame(JNIEnv* env, jint capacity = 16)
+      : env_(env), outstanding_(LocalRefDebug::outstanding()) {
+    pushed_ = env_->PushLocalFrame(capacity) == JNI_OK;
+  }
+
+  LocalFrame(const LocalFrame&) = delete;
+  LocalFrame& operator=(const LocalFrame&) = delete;
+
+  ~LocalFrame() {
+    if (pushed_) {
+      popFrame(nullptr);
+    }
+  }
+
+  /**
+   * false if the frame could not be pushed (OutOfMemoryError pending)
+   */
+  bool ok() const {
+    return pushed_;
+  }
+
+  /**
+   * Pop the frame now, promoting result to the outer frame
+   */
+  template <class T>
+  T pop(T result) {
+    if (!pushed_) {
+      return result;
+    }
+    return (T) popFrame(result);
+  }
+
+ private:
+  jobject popFrame(jobject result) {
+    pushed_ = false;
+    long leaked = LocalRefDebug::outstanding() - outstanding_;
+    if (leaked > 0) {
+      LocalRefDebug::report("LocalRef handles outlive their LocalFrame", leaked);
+    }
+    return env_->PopLocalFrame(result);
+  }
+};
+
+/**
+ * Report LocalRef handles created in the scope and still alive at its end
+ * (only with LocalRefDebug enabled)
+ */
+class LocalRefLeakCheck {
+ private:
+  const char* name_;
+  long outstanding_;
+
+ public:
+  explicit LocalRefLeakCheck(const char* name)
+      : name_(name), outstanding_(LocalRefDebug::outstanding()) {}
+
+  LocalRefLeakCheck(const LocalRefLeakCheck&) = delete;
+  LocalRefLeakCheck& operator=(const LocalRefLeakCheck&) = delete;
+
+  ~LocalRefLeakCheck() {
+    long leaked = LocalRefDebug::outstanding() - outstanding_;
+    if (leaked > 0) {
+      LocalRefDebug::report(name_, leaked);
+    }
+  }
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_LOCAL_REF_H_
@@ -0,0 +1,72 @@
+/**
+ * @file	mapped_buffer_registry.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/23
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_MAPPED_BUFFER_REGISTRY_H_
+#define JCU_JVM_MAPPED_BUFFER_REGISTRY_H_
+
+#include <memory>
+
+#include <jni.h>
+
+#include "pointer_ref.h"
+#include "os_handler.h"
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Memory mapped files published to java as read-only direct ByteBuffers.
+ *
+ * A mapping is shared by native (the std::shared_ptr returned by map()) and
+ * every ByteBuffer published from it. Each publish() tracks the buffer with a
+ * java.lang.ref.PhantomReference, the mapping is unmapped once native dropped
+ * its references and reap() saw all of its buffers collected.
+ * reap() runs on every publish() and can be called periodically.
+ */
+class MappedBufferRegistry {
+ public:
+  virtual ~MappedBufferRegistry() {}
+
+  /**
+   * @param length 0 maps up to the end of the file
+   * @param error  optional, set to the system error code
+   * @return null on failure
+   */
+  virtual std::shared_ptr<FileMapping> map(const char* path, uint64_t offset = 0, size_t length = 0, int* error = nullptr) = 0;
+
+  /**
+   * @return local reference of a read-only ByteBuffer over the mapping,
+   *         null with the java exception pending on failure
+   */
+  virtual jobject publish(JNIEnv* env, const std::shared_ptr<FileMapping>& mapping) = 0;
+
+  /**
+   * Drop the mapping references of collected buffers
+   * @return number of buffers reaped
+   */
+  virtual size_t reap(JNIEnv* env) = 0;
+
+  /**
+   * number of published buffers not reaped yet
+   */
+  virtual size_t publishedCount() const = 0;
+
+  /**
+   * Release the java objects and the mapping references held for java.
+   * Must be called before VM::destroy(), published buffers must not be used afterwards.
+   */
+  virtual void destroy(JNIEnv* env) = 0;
+
+  static MappedBufferRegistry* create(PointerRef<OsHandler> os_handler);
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_MAPPED_BUFFER_REGISTRY_H_
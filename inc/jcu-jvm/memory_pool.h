@@ -18,15 +18,79 @@
 namespace jcu {
 namespace jvm {
 
+/**
+ * Memory pool used for marshalling.
+ *
+ * Implementations are not thread safe unless noted otherwise
+ * (see createConcurrentMemoryPool()).
+ */
 class MemoryPool {
  public:
+  virtual ~MemoryPool() {}
   virtual void* allocate(size_t size) = 0;
   virtual bool release(void *ptr) = 0;
   virtual void releaseAll() = 0;
 };
 
+/**
+ * Bump pointer arena.
+ *
+ * allocate() is O(1) and releaseAll() is O(chunks). Memory is reclaimed by
+ * releaseAll(); release() only rewinds the most recent allocation and returns
+ * false for any other pointer.
+ */
+class ArenaMemoryPool : public MemoryPool {
+ public:
+  struct Options {
+    /**
+     * size of each heap chunk, larger requests get a dedicated chunk
+     */
+    size_t chunk_size;
+    /**
+     * alignment of every returned pointer (power of two)
+     */
+    size_t alignment;
+    /**
+     * optional caller owned first block (e.g. on the stack), used before any heap chunk
+     */
+    void* inline_block;
+    size_t inline_block_size;
+
+    Options()
+        : chunk_size(4096), alignment(sizeof(void*) * 2), inline_block(nullptr), inline_block_size(0) {}
+  };
+
+  struct Stats {
+    /**
+     * sum of the requested sizes of live allocations
+     */
+    size_t bytes_used;
+    /**
+     * alignment padding and chunk tails left unused
+     */
+    size_t bytes_wasted;
+    /**
+     * capacity of all chunks including the inline block
+     */
+    size_t bytes_reserved;
+    size_t chunk_count;
+  };
+
+  virtual Stats getStats() const = 0;
+};
+
 extern MemoryPool* createSimpleMemoryPool();
 
+/**
+ * Thread safe pool for sharing between threads.
+ * allocate() and release() may be called concurrently from any thread,
+ * releaseAll() must not overlap with them.
+ * release() only takes pointers allocated by such a pool and not reclaimed by
+ * releaseAll(), it returns false for a double release.
+ */
+extern MemoryPool* createConcurrentMemoryPool();
+extern ArenaMemoryPool* createArenaMemoryPool(const ArenaMemoryPool::Options& options = ArenaMemoryPool::Options());
+
 } // namespace jvm
 } // namespace jcu
 
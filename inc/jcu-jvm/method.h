@@ -0,0 +1,166 @@
+/**
+ * @file	method.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/12
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_METHOD_H_
+#define JCU_JVM_METHOD_H_
+
+#include "jni_signature.h"
+#include "id_registry.h"
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Typed static method
+ *
+ * StaticMethod<jboolean(jstring, Array<jstring>)> load;
+ * load.resolve(env, clazz, "load");
+ * jboolean ok = load(env, name, args);
+ */
+template <class F>
+class StaticMethod;
+
+template <class R, class... Args>
+class StaticMethod<R(Args...)> {
+ private:
+  jclass clazz_;
+  jmethodID method_;
+
+ public:
+  StaticMethod(jclass clazz = nullptr, jmethodID method = nullptr)
+      : clazz_(clazz), method_(method) {}
+
+  static const char* signature() {
+    return MethodSignature<R(Args...)>::value.c_str();
+  }
+
+  bool resolve(JNIEnv* env, jclass clazz, const char* name) {
+    clazz_ = clazz;
+    method_ = env->GetStaticMethodID(clazz, name, signature());
+    return method_ != nullptr;
+  }
+
+  jmethodID id() const {
+    return method_;
+  }
+
+  R operator()(JNIEnv* env, Args... args) const {
+    const jvalue values[sizeof...(Args) + 1] = {JniType<Args>::toJvalue(args)...};
+    return JniType<R>::callStatic(env, clazz_, method_, values);
+  }
+};
+
+/**
+ * Typed instance method (virtual dispatch)
+ *
+ * Method<jboolean()> start;
+ * start.resolve(env, clazz, "start");
+ * jboolean ok = start(env, obj);
+ */
+template <class F>
+class Method;
+
+template <class R, class... Args>
+class Method<R(Args...)> {
+ private:
+  jmethodID method_;
+
+ public:
+  Method(jmethodID method = nullptr)
+      : method_(method) {}
+
+  static const char* signature() {
+    return MethodSignature<R(Args...)>::value.c_str();
+  }
+
+  bool resolve(JNIEnv* env, jclass clazz, const char* name) {
+    method_ = env->GetMethodID(clazz, name, signature());
+    return method_ != nullptr;
+  }
+
+  jmethodID id() const {
+    return method_;
+  }
+
+  R operator()(JNIEnv* env, jobject obj, Args... args) const {
+    const jvalue values[sizeof...(Args) + 1] = {JniType<Args>::toJvalue(args)...};
+    return JniType<R>::call(env, obj, method_, values);
+  }
+};
+
+/**
+ * Base of the typed registry keys, the signature is generated from F and
+ * the ids are resolved once through IdRegistry.
+ */
+template <class Key, class F>
+struct StaticMethodKey;
+
+template <class Key, class R, class... Args>
+struct StaticMethodKey<Key, R(Args...)> {
+  static const IdRegistry::Kind kind = IdRegistry::kStaticMethod;
+
+  static const char* signature() {
+    return MethodSignature<R(Args...)>::value.c_str();
+  }
+
+  /**
+   * @return R() with the java exception pending if the method can not be resolved
+   */
+  static R call(JNIEnv* env, Args... args) {
+    jmethodID method = IdRegistry::getMethod<Key>(env);
+    if (!method) {
+      return R();
+    }
+    jclass clazz = IdRegistry::getClass<typename Key::class_key>(env);
+    return StaticMethod<R(Args...)>(clazz, method)(env, args...);
+  }
+};
+
+template <class Key, class F>
+struct MethodKey;
+
+template <class Key, class R, class... Args>
+struct MethodKey<Key, R(Args...)> {
+  static const IdRegistry::Kind kind = IdRegistry::kMethod;
+
+  static const char* signature() {
+    return MethodSignature<R(Args...)>::value.c_str();
+  }
+
+  static R call(JNIEnv* env, jobject obj, Args... args) {
+    jmethodID method = IdRegistry::getMethod<Key>(env);
+    if (!method) {
+      return R();
+    }
+    return Method<R(Args...)>(method)(env, obj, args...);
+  }
+};
+
+/**
+ * Declare a typed method key
+ *
+ * JCU_JVM_TYPED_STATIC_METHOD_KEY(DaemonLoaderLoad, DaemonLoader, "load", jboolean(jstring, Array<jstring>));
+ * jboolean ok = DaemonLoaderLoad::call(env, name, args);
+ */
+#define JCU_JVM_TYPED_STATIC_METHOD_KEY(KEY, CLASS_KEY, NAME, ...) \
+  struct KEY : ::jcu::jvm::StaticMethodKey<KEY, __VA_ARGS__> { \
+    typedef CLASS_KEY class_key; \
+    static const char* name() { return NAME; } \
+  }
+
+#define JCU_JVM_TYPED_METHOD_KEY(KEY, CLASS_KEY, NAME, ...) \
+  struct KEY : ::jcu::jvm::MethodKey<KEY, __VA_ARGS__> { \
+    typedef CLASS_KEY class_key; \
+    static const char* name() { return NAME; } \
+  }
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_METHOD_H_
@@ -0,0 +1,346 @@
+/**
+ * @file	native_method.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/26
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_NATIVE_METHOD_H_
+#define JCU_JVM_NATIVE_METHOD_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <jni.h>
+
+#include "jni_signature.h"
+
+namespace jcu {
+namespace jvm {
+
+namespace intl {
+
+/**
+ * Type crossing the JNI boundary for a typed argument or result
+ */
+template <class T>
+struct NativeType {
+  typedef T type;
+};
+
+template <class ClassKey>
+struct NativeType<Object<ClassKey>> {
+  typedef jobject type;
+};
+
+template <class Element>
+struct NativeType<Array<Element>> {
+  typedef jobjectArray type;
+};
+
+template <class T>
+struct CallableTraits : CallableTraits<decltype(&T::operator())> {};
+
+template <class C, class R, class... Args>
+struct CallableTraits<R (C::*)(Args...)> : CallableTraits<R(Args...)> {};
+
+template <class C, class R, class... Args>
+struct CallableTraits<R (C::*)(Args...) const> : CallableTraits<R(Args...)> {};
+
+template <class R, class... Args>
+struct CallableTraits<R (*)(Args...)> : CallableTraits<R(Args...)> {};
+
+/**
+ * A native method is R(JNIEnv*, jobject this or jclass, Args...),
+ * the java descriptor is generated from R(Args...)
+ */
+template <class R, class Self, class... Args>
+struct CallableTraits<R(JNIEnv*, Self, Args...)> {
+  static_assert(std::is_same<Self, jobject>::value || std::is_same<Self, jclass>::value,
+                "the second parameter of a native method must be jobject or jclass");
+
+  typedef R result_type;
+  typedef Self self_type;
+  typedef std::function<R(JNIEnv*, Self, Args...)> function_type;
+  typedef MethodSignature<R(Args...)> signature;
+};
+
+/**
+ * JNI entry point calling Holder::instance
+ */
+template <class Holder, class F>
+struct NativeTrampoline;
+
+template <class Holder, class R, class Self, class... Args>
+struct NativeTrampoline<Holder, R(JNIEnv*, Self, Args...)> {
+  static typename NativeType<R>::type JNICALL invoke(JNIEnv* env, Self self, typename NativeType<Args>::type... args) {
+    return static_cast<typename NativeType<R>::type>((*Holder::instance.load(std::memory_order_acquire))(env, self, Args(args)...));
+  }
+};
+
+template <class Holder, class Self, class... Args>
+struct NativeTrampoline<Holder, void(JNIEnv*, Self, Args...)> {
+  static void JNICALL invoke(JNIEnv* env, Self self, typename NativeType<Args>::type... args) {
+    (*Holder::instance.load(std::memory_order_acquire))(env, self, Args(args)...);
+  }
+};
+
+/**
+ * Every lambda expression has its own type, so its trampoline is a
+ * dedicated function reading one static pointer.
+ */
+template <class Fn>
+struct CallableHolder {
+  static std::atomic<Fn*> instance;
+};
+
+template <class Fn>
+std::atomic<Fn*> CallableHolder<Fn>::instance(nullptr);
+
+/**
+ * std::function and function pointers share their type between bindings,
+ * they get one of kNativeFunctionSlots trampolines of their signature.
+ */
+static const size_t kNativeFunctionSlots = 32;
+
+template <class Function, size_t I>
+struct FunctionSlotHolder {
+  static std::atomic<Function*> instance;
+};
+
+template <class Function, size_t I>
+std::atomic<Function*> FunctionSlotHolder<Function, I>::instance(nullptr);
+
+/**
+ * Publish state to the trampoline of Holder
+ * @return the trampoline, null if another state is installed
+ */
+template <class Holder, class Stored, class F>
+void* installState(void* state) {
+  Stored* expected = nullptr;
+  if (!Holder::instance.compare_exchange_strong(expected, static_cast<Stored*>(state), std::memory_order_acq_rel) &&
+      expected != static_cast<Stored*>(state)) {
+    return nullptr;
+  }
+  return (void*) &NativeTrampoline<Holder, F>::invoke;
+}
+
+template <class Holder, class Stored>
+void uninstallState(void* state) {
+  Stored* expected = static_cast<Stored*>(state);
+  Holder::instance.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+}
+
+/**
+ * Trampolines of one std::function type, a slot is claimed at registration
+ * and given back when the registration is dropped.
+ */
+template <class F, class Function, class Slots>
+struct FunctionSlots;
+
+template <class F, class Function, size_t... I>
+struct FunctionSlots<F, Function, std::index_sequence<I...>> {
+  static std::atomic<Function*>& holder(size_t slot) {
+    static std::atomic<Function*>* const table[] = {&FunctionSlotHolder<Function, I>::instance...};
+    return *table[slot];
+  }
+
+  static void* trampoline(size_t slot) {
+    static void* const table[] = {(void*) &NativeTrampoline<FunctionSlotHolder<Function, I>, F>::invoke...};
+    return table[slot];
+  }
+
+  /**
+   * @return the trampoline of the slot serving state, null if all slots are taken
+   */
+  static void* install(void* state) {
+    Function* stored = static_cast<Function*>(state);
+    for (size_t slot = 0; slot < sizeof...(I); slot++) {
+      if (holder(slot).load(std::memory_order_acquire) == stored) {
+        return trampoline(slot);
+      }
+    }
+    for (size_t slot = 0; slot < sizeof...(I); slot++) {
+      Function* expected = nullptr;
+      if (holder(slot).compare_exchange_strong(expected, stored, std::memory_order_acq_rel)) {
+        return trampoline(slot);
+      }
+    }
+    return nullptr;
+  }
+
+  static void uninstall(void* state) {
+    for (size_t slot = 0; slot < sizeof...(I); slot++) {
+      Function* expected = static_cast<Function*>(state);
+      holder(slot).compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+    }
+  }
+};
+
+} // namespace intl
+
+/**
+ * Set of native methods of one class, registered by VM::registerNatives()
+ *
+ * The callables are R(JNIEnv*, jobject, Args...) for instance methods and
+ * R(JNIEnv*, jclass, Args...) for static methods, the java descriptor is
+ * generated from R(Args...) (see MethodSignature).
+ * A callable must not throw.
+ *
+ * NativeMethods methods;
+ * methods.bind("onData", [&sink](JNIEnv* env, jobject self, jbyteArray data, jint length) {
+ *   sink.push(env, data, length);
+ * });
+ * vm->registerNatives(env, "com/example/Bridge", methods);
+ */
+class NativeMethods {
+ public:
+  struct Entry {
+    std::string name;
+    std::string signature;
+    /**
+     * JNI function, null if install() picks the trampoline
+     */
+    void* fn;
+    /**
+     * bound callable, kept alive by the vm once registered
+     */
+    std::shared_ptr<void> state;
+    /**
+     * publish state to a trampoline, null for raw functions
+     * @return the trampoline to register, null if none is free for state
+     */
+    void* (*install)(void* state);
+    /**
+     * detach state from the trampoline if it is still installed
+     */
+    void (*uninstall)(void* state);
+  };
+
+ private:
+  std::vector<Entry> entries_;
+  bool valid_;
+
+  template <class Fn, class F>
+  NativeMethods& bindCallable(const char* name, Fn&& fn, F*) {
+    typedef typename std::decay<Fn>::type stored_type;
+    typedef intl::CallableHolder<stored_type> holder_type;
+    if (holder_type::instance.load(std::memory_order_acquire)) {
+      // this lambda expression is already registered
+      valid_ = false;
+      return *this;
+    }
+    Entry entry;
+    entry.name = name;
+    entry.signature = intl::CallableTraits<stored_type>::signature::value.c_str();
+    entry.fn = (void*) &intl::NativeTrampoline<holder_type, F>::invoke;
+    entry.state = std::make_shared<stored_type>(std::forward<Fn>(fn));
+    entry.install = &intl::installState<holder_type, stored_type, F>;
+    entry.uninstall = &intl::uninstallState<holder_type, stored_type>;
+    entries_.emplace_back(std::move(entry));
+    return *this;
+  }
+
+  template <class Function, class R, class Self, class... Args>
+  NativeMethods& bindFunction(const char* name, Function&& fn, R (*)(JNIEnv*, Self, Args...)) {
+    typedef R F(JNIEnv*, Self, Args...);
+    typedef typename intl::CallableTraits<F>::function_type function_type;
+    typedef intl::FunctionSlots<F, function_type, std::make_index_sequence<intl::kNativeFunctionSlots>> slots_type;
+    Entry entry;
+    entry.name = name;
+    entry.signature = intl::CallableTraits<F>::signature::value.c_str();
+    entry.fn = nullptr;
+    entry.state = std::make_shared<function_type>(std::forward<Function>(fn));
+    entry.install = &slots_type::install;
+    entry.uninstall = &slots_type::uninstall;
+    entries_.emplace_back(std::move(entry));
+    return *this;
+  }
+
+  template <class T>
+  struct IsStdFunction : std::false_type {};
+
+  template <class F>
+  struct IsStdFunction<std::function<F>> : std::true_type {};
+
+  template <class T>
+  struct FunctionTypeOf;
+
+  template <class F>
+  struct FunctionTypeOf<std::function<F>> {
+    typedef F type;
+  };
+
+ public:
+  NativeMethods() : valid_(true) {}
+
+  /**
+   * Bind a lambda or function object.
+   * A lambda expression serves one registration at a time (until the VM
+   * holding it is deleted): binding it again while it is registered makes
+   * valid() false, registering two bindings of it fails with JNI_ERR.
+   */
+  template <class Fn, typename std::enable_if<
+      !IsStdFunction<typename std::decay<Fn>::type>::value && !std::is_pointer<typename std::decay<Fn>::type>::value, int>::type = 0>
+  NativeMethods& bind(const char* name, Fn&& fn) {
+    typedef typename std::decay<Fn>::type stored_type;
+    typedef typename FunctionTypeOf<typename intl::CallableTraits<stored_type>::function_type>::type function_type;
+    return bindCallable(name, std::forward<Fn>(fn), (function_type*) nullptr);
+  }
+
+  /**
+   * Bind a std::function or function pointer.
+   * At most kNativeFunctionSlots of them can be registered per signature at
+   * a time, registerNatives() fails with JNI_ERR past that. A slot is given
+   * back when the VM holding the registration is deleted.
+   */
+  template <class F>
+  NativeMethods& bind(const char* name, std::function<F> fn) {
+    return bindFunction(name, std::move(fn), (F*) nullptr);
+  }
+
+  template <class R, class Self, class... Args>
+  NativeMethods& bind(const char* name, R (*fn)(JNIEnv*, Self, Args...)) {
+    return bindFunction(name, std::function<R(JNIEnv*, Self, Args...)>(fn), (R (*)(JNIEnv*, Self, Args...)) nullptr);
+  }
+
+  /**
+   * Bind a plain JNI function with an explicit descriptor
+   */
+  NativeMethods& bind(const char* name, const char* signature, void* fn) {
+    Entry entry;
+    entry.name = name;
+    entry.signature = signature;
+    entry.fn = fn;
+    entry.install = nullptr;
+    entry.uninstall = nullptr;
+    entries_.emplace_back(std::move(entry));
+    return *this;
+  }
+
+  bool valid() const {
+    return valid_;
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  const std::vector<Entry>& entries() const {
+    return entries_;
+  }
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_NATIVE_METHOD_H_
@@ -10,9 +10,13 @@
 #ifndef JCU_JVM_OS_HANDLER_H_
 #define JCU_JVM_OS_HANDLER_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <string>
 
 #include "pointer_ref.h"
+#include "startup_trace.h"
 
 namespace jcu {
 namespace jvm {
@@ -30,10 +34,59 @@ class DsoHandle {
   virtual const char* getPath() const = 0;
 };
 
+/**
+ * Read-only memory mapping of a file or file range
+ */
+class FileMapping {
+ public:
+  enum Advice {
+    kAdviceNormal = 0,
+    kAdviceSequential,
+    kAdviceRandom,
+    kAdviceWillNeed,
+    kAdviceDontNeed,
+  };
+
+  virtual ~FileMapping() = default;
+  /**
+   * @param path   utf8 string
+   * @param length 0 maps up to the end of the file
+   * @return system error code
+   */
+  virtual int open(const char* path, uint64_t offset = 0, size_t length = 0) = 0;
+  virtual bool isMapped() const = 0;
+  virtual const void* data() const = 0;
+  virtual size_t size() const = 0;
+  /**
+   * Paging hint for the whole mapping (madvise)
+   * @return system error code, ENOTSUP-like codes where the platform has no equivalent
+   */
+  virtual int advise(Advice advice) = 0;
+  virtual void close() = 0;
+};
+
 struct JvmLibraryPathInfo {
   std::string java_home;
   std::string jvm_path;
   std::string jsig_path;
+  /**
+   * vm flavour of jvm_path ("server", "client", ...), empty if unknown
+   */
+  std::string vm_name;
+  /**
+   * time spent in findJvmLibrary(), reported as StartupTrace::kPhaseFindJvmLibrary after load
+   */
+  StartupTrace::Timing discovery;
+};
+
+/**
+ * Which vm findJvmLibrary() picks when JAVA_HOME has more than one
+ */
+enum VmSelection {
+  kVmSelectServer = 0,
+  kVmSelectClient,
+  kVmSelectMinimal,
+  kVmSelectExplicit,
 };
 
 class OsHandler {
@@ -42,9 +95,46 @@ class OsHandler {
 
   virtual JvmLibraryPathInfo findJvmLibrary(const char* jvm_dll_path = nullptr, const char* java_home_path = nullptr) const = 0;
 
+  /**
+   * Enable the on-disk cache of findJvmLibrary() results (disabled by default).
+   * Entries are keyed by JAVA_HOME and validated against the identity
+   * (inode/mtime/size) of the cached jvm library, a warm lookup costs one stat.
+   * @param cache_file null or utf8 path of the cache file, null disables the cache
+   */
+  virtual void setDiscoveryCache(const char* cache_file) = 0;
+
+  /**
+   * VM selection policy of findJvmLibrary(), kVmSelectServer by default.
+   * The vms listed in jvm.cfg are tried with the selected one first.
+   * @param vm_name vm name for kVmSelectExplicit (e.g. "server", "zero")
+   */
+  virtual void setVmSelection(VmSelection selection, const char* vm_name = nullptr) = 0;
+
+  /**
+   * Identity of a file (inode/mtime/size...) that changes when it is replaced
+   * @param path utf8 string
+   * @return empty if the file does not exist
+   */
+  virtual std::string getFileFingerprint(const char* path) const = 0;
+
   virtual DsoHandle* createDsoHandle() const = 0;
+
+  /**
+   * @param handle null or handle to open path with
+   * @param path   library path, or the name of a library registered in
+   *               BuiltinLibraries (handle null), which is resolved from
+   *               the process image without loading anything
+   */
   virtual DsoHandle* loadLibrary(DsoHandle* handle, const char* path) const = 0;
 
+  /**
+   * Symbol exported by the process image (the executable and its global
+   * dependencies), as the vm resolves builtin JNI libraries
+   */
+  virtual void* getProcessSymbol(const char* name) const = 0;
+
+  virtual FileMapping* createFileMapping() const = 0;
+
   virtual int getCurrentPid() const = 0;
   virtual int getParentPid() const = 0;
 
@@ -0,0 +1,93 @@
+/**
+ * @file	startup_trace.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/19
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_STARTUP_TRACE_H_
+#define JCU_JVM_STARTUP_TRACE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Per-phase timing of the vm startup (steady clock, nanoseconds)
+ */
+class StartupTrace {
+ public:
+  enum Phase {
+    /**
+     * OsHandler::findJvmLibrary() path probing (or discovery cache lookup)
+     */
+    kPhaseFindJvmLibrary = 0,
+    kPhaseLoadJsig,
+    kPhaseLoadJvm,
+    kPhaseResolveSymbols,
+    kPhaseGetDefaultInitArgs,
+    kPhaseBuildOptions,
+    kPhaseCreateJavaVM,
+    kPhaseFirstFindClass,
+    kPhaseCount,
+  };
+
+  struct Timing {
+    bool recorded = false;
+    uint64_t begin_ns = 0;
+    uint64_t duration_ns = 0;
+  };
+
+ private:
+  Timing timings_[kPhaseCount];
+
+ public:
+  void reset() {
+    for (int i = 0; i < kPhaseCount; i++) {
+      timings_[i] = Timing();
+    }
+  }
+
+  void record(Phase phase, uint64_t begin_ns, uint64_t end_ns) {
+    Timing& timing = timings_[phase];
+    timing.recorded = true;
+    timing.begin_ns = begin_ns;
+    timing.duration_ns = (end_ns > begin_ns) ? (end_ns - begin_ns) : 0;
+  }
+
+  void set(Phase phase, const Timing& timing) {
+    timings_[phase] = timing;
+  }
+
+  const Timing& get(Phase phase) const {
+    return timings_[phase];
+  }
+
+  /**
+   * sum of the recorded phase durations
+   */
+  uint64_t totalNs() const;
+
+  /**
+   * {"total_ns":..., "phases":[{"name":"find_jvm_library","offset_ns":...,"duration_ns":...}, ...]}
+   * offset_ns is relative to the earliest recorded phase, unrecorded phases are omitted.
+   */
+  std::string toJson() const;
+
+  static const char* phaseName(Phase phase);
+
+  /**
+   * steady clock timestamp in nanoseconds
+   */
+  static uint64_t now();
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_STARTUP_TRACE_H_
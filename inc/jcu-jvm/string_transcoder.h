@@ -0,0 +1,77 @@
+/**
+ * @file	string_transcoder.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/25
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_STRING_TRANSCODER_H_
+#define JCU_JVM_STRING_TRANSCODER_H_
+
+#include <stddef.h>
+
+#include <string>
+
+#include <jni.h>
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Conversions between standard UTF-8, UTF-16 (java strings) and the
+ * modified UTF-8 of JNI (NUL as C0 80, supplementary characters as two
+ * 3-byte surrogates).
+ *
+ * ASCII runs are converted with SSE2/AVX2/NEON when the cpu supports it,
+ * chosen once at runtime. Invalid input is replaced by U+FFFD.
+ * Every function returns the number of units written to dst.
+ */
+class StringTranscoder {
+ public:
+  /**
+   * @param dst capacity of at least length units
+   */
+  static size_t utf8ToUtf16(const char* src, size_t length, jchar* dst);
+
+  /**
+   * @param dst capacity of at least length * 3 bytes
+   */
+  static size_t utf16ToUtf8(const jchar* src, size_t length, char* dst);
+
+  /**
+   * @param dst capacity of at least length * 3 bytes
+   */
+  static size_t utf8ToModifiedUtf8(const char* src, size_t length, char* dst);
+
+  /**
+   * @param dst capacity of at least length * 3 bytes
+   */
+  static size_t modifiedUtf8ToUtf8(const char* src, size_t length, char* dst);
+
+  /**
+   * Java string from standard UTF-8 (NewString)
+   * @return local reference, null with the java exception pending on failure
+   */
+  static jstring newString(JNIEnv* env, const char* utf8, size_t length);
+  static jstring newString(JNIEnv* env, const std::string& utf8) {
+    return newString(env, utf8.data(), utf8.length());
+  }
+
+  /**
+   * Standard UTF-8 of a java string (GetStringRegion)
+   * @return false with the java exception pending on failure
+   */
+  static bool getString(JNIEnv* env, jstring str, std::string* utf8);
+
+  /**
+   * "avx2", "sse2", "neon" or "scalar"
+   */
+  static const char* implementation();
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_STRING_TRANSCODER_H_
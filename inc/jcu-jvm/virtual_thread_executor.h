@@ -0,0 +1,74 @@
+/**
+ * @file	virtual_thread_executor.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/30
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_VIRTUAL_THREAD_EXECUTOR_H_
+#define JCU_JVM_VIRTUAL_THREAD_EXECUTOR_H_
+
+#include <jni.h>
+
+#include "vm.h"
+#include "java_future.h"
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Java tasks run on virtual threads (JDK 21+).
+ *
+ * Tasks are java.lang.Runnable or java.util.function.Supplier objects run
+ * through CompletableFuture.runAsync / supplyAsync on a cached virtual
+ * thread ExecutorService, so blocking java code does not hold an attached
+ * platform thread. Completion comes back through JavaFutures.
+ * Native code should not block inside a virtual thread: a native frame pins
+ * its carrier thread, use VmExecutor for native work.
+ */
+class VirtualThreadExecutor {
+ public:
+  struct Options {
+    /**
+     * java.lang.Thread names are "<prefix><counter>", null for unnamed threads
+     */
+    const char* thread_name_prefix;
+
+    Options()
+        : thread_name_prefix(nullptr) {}
+  };
+
+  virtual ~VirtualThreadExecutor() {}
+
+  /**
+   * Start task on a new virtual thread
+   * @return local reference of its CompletableFuture (see awaitFuture()),
+   *         null with the java exception pending on failure
+   */
+  virtual jobject start(JNIEnv* env, jobject task) = 0;
+
+  /**
+   * Start task and call callback on executor when it completes
+   * (see JavaFutures::whenComplete())
+   * @return false with the java exception pending on failure
+   */
+  virtual bool submit(JNIEnv* env, jobject task, JavaFutures::Executor executor, JavaFutures::Callback callback) = 0;
+
+  /**
+   * Stop accepting tasks (ExecutorService.shutdown()), running tasks still complete.
+   * Must be called before VM::destroy().
+   */
+  virtual void shutdown(JNIEnv* env) = 0;
+
+  /**
+   * @return null if the vm has no virtual threads (the exception is cleared)
+   */
+  static VirtualThreadExecutor* create(VM* vm, JNIEnv* env, const Options& options = Options());
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_VIRTUAL_THREAD_EXECUTOR_H_
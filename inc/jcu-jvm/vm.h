@@ -10,30 +10,182 @@
 #ifndef JCU_JVM_VM_H_
 #define JCU_JVM_VM_H_
 
+#include <functional>
+#include <future>
+
 #include "pointer_ref.h"
 #include "jvm_library.h"
 #include "memory_pool.h"
+#include "startup_trace.h"
+#include "handle_table.h"
+#include "native_method.h"
 
 namespace jcu {
 namespace jvm {
 
 class VM {
  public:
+  virtual ~VM() {}
+
   virtual jint init(const char* classpath, const JavaVMInitArgs* init_args = nullptr, MemoryPool* mpool = nullptr) = 0;
+
+  /**
+   * Start the vm on a dedicated owner thread and return immediately.
+   *
+   * The owner thread loads the jvm library if it is not loaded yet
+   * (path_info, or OsHandler::findJvmLibrary() defaults when null), creates
+   * the vm and stays attached as its primordial thread until destroy(),
+   * which runs DestroyJavaVM on it.
+   * classpath and init_args are copied. Other methods must not be used
+   * before the returned future is ready.
+   *
+   * @param on_complete called on the owner thread with the result, may be empty
+   */
+  virtual std::future<jint> initAsync(
+      const char* classpath,
+      const JavaVMInitArgs* init_args = nullptr,
+      std::function<void(jint)> on_complete = nullptr,
+      const JvmLibraryPathInfo* path_info = nullptr,
+      bool jsig_load = false) = 0;
+
   virtual jint destroy() = 0;
 
+  /**
+   * Manage AppCDS archives in dir (disabled by default), applied by the next init().
+   *
+   * The first init() of a classpath is a training run that dumps the loaded
+   * classes when the vm exits (-XX:ArchiveClassesAtExit, JDK 13+), later runs
+   * map the archive (-XX:SharedArchiveFile). The archive is keyed by the
+   * classpath and retrained when the jvm library path or file changes.
+   * Ignored if the init args already contain CDS options.
+   * @param dir null or utf8 path of an existing directory, null disables it
+   */
+  virtual void setCdsArchiveDir(const char* dir) = 0;
+
+  /**
+   * Grant restricted methods (java.lang.foreign) to the classpath with
+   * --enable-native-access=ALL-UNNAMED, applied by the next init() if
+   * foreignLinkerSupported(). Disabled by default.
+   */
+  virtual void setNativeAccess(bool enable) = 0;
+
+  /**
+   * Whether the jvm library accepted JNI_VERSION_21 in the last init().
+   * JNI has no newer version to probe, so this is also true on JDK 21
+   * where java.lang.foreign is still a preview api; ForeignFunctions checks
+   * the java version before using the FFM fast path.
+   */
+  virtual bool foreignLinkerSupported() const = 0;
+
+  /**
+   * Timing of the last init(), merged with JvmLibrary::getStartupTrace().
+   * Only meaningful once init() has returned (or the initAsync() future is ready).
+   */
+  virtual StartupTrace getStartupTrace() const = 0;
+
+  /**
+   * Handle table of this vm, cleared by destroy()
+   */
+  virtual HandleTable* handles() = 0;
+
+  /**
+   * Bind methods as native methods of clazz through RegisterNatives.
+   * The bound callables are kept alive until this object is deleted.
+   * @return JNI_ERR without registering anything if !methods.valid() or a
+   *         callable cannot get a trampoline, otherwise the result of
+   *         RegisterNatives. If RegisterNatives fails, all native methods of
+   *         clazz are unregistered and the callables are released.
+   */
+  virtual jint registerNatives(JNIEnv* env, jclass clazz, const NativeMethods& methods) = 0;
+
+  /**
+   * @param class_name binary name of the class ("com/example/Bridge")
+   */
+  virtual jint registerNatives(JNIEnv* env, const char* class_name, const NativeMethods& methods) = 0;
+
   virtual JavaVM* jvm() const = 0;
+
+  /**
+   * JNIEnv of the calling thread
+   * @return nullptr if the calling thread is not attached
+   */
   virtual JNIEnv* env() const = 0;
 
+  /**
+   * System.exit(code), an exception it throws is cleared
+   */
   virtual void callExit(jint code) = 0;
 
+  /**
+   * Attach the calling thread (cached per thread).
+   * A thread attached by this library is detached automatically when it exits,
+   * detachThread() is only needed to detach earlier.
+   * Only platform threads can be attached, java work can run on virtual
+   * threads through VirtualThreadExecutor.
+   * @param attached set to true if the thread was newly attached
+   */
   virtual jint attachThread(bool* attached) = 0;
   virtual jint attachThreadEnv(JNIEnv** env, bool* attached) = 0;
+
+  /**
+   * @param thread_name null or java.lang.Thread name (modified utf8)
+   * @param daemon      attach as daemon thread, the vm does not wait for it on destroy
+   */
+  virtual jint attachThreadEnv(JNIEnv** env, bool* attached, const char* thread_name, bool daemon = false) = 0;
   virtual jint detachThread() = 0;
 
   static VM* create(PointerRef<JvmLibrary> jvm_library);
 };
 
+/**
+ * Scoped JNIEnv of the calling thread
+ */
+class ScopedEnv {
+ public:
+  enum DetachPolicy {
+    kDetachOnThreadExit = 0,
+    kDetachOnScopeExit,
+  };
+
+ private:
+  VM* vm_;
+  JNIEnv* env_;
+  bool attached_;
+  DetachPolicy policy_;
+  jint rc_;
+
+ public:
+  explicit ScopedEnv(VM* vm, const char* thread_name = nullptr, bool daemon = false, DetachPolicy policy = kDetachOnThreadExit)
+      : vm_(vm), env_(nullptr), attached_(false), policy_(policy) {
+    rc_ = vm_->attachThreadEnv(&env_, &attached_, thread_name, daemon);
+  }
+
+  ~ScopedEnv() {
+    if (attached_ && policy_ == kDetachOnScopeExit) {
+      vm_->detachThread();
+    }
+  }
+
+  ScopedEnv(const ScopedEnv&) = delete;
+  ScopedEnv& operator=(const ScopedEnv&) = delete;
+
+  jint result() const {
+    return rc_;
+  }
+
+  JNIEnv* get() const {
+    return env_;
+  }
+
+  JNIEnv* operator->() const {
+    return env_;
+  }
+
+  operator bool() const {
+    return env_ != nullptr;
+  }
+};
+
 } // namespace jvm
 } // namespace jcu
 
@@ -0,0 +1,91 @@
+/**
+ * @file	vm_executor.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/21
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_VM_EXECUTOR_H_
+#define JCU_JVM_VM_EXECUTOR_H_
+
+#include <stddef.h>
+
+#include <functional>
+
+#include <jni.h>
+
+#include "vm.h"
+
+namespace jcu {
+namespace jvm {
+
+/**
+ * Fixed pool of native threads that stay attached to the vm.
+ *
+ * Each worker attaches once, keeps its JNIEnv and runs tasks from its own
+ * deque (newest first), stealing the oldest task of another worker when
+ * its deque is empty. Tasks submitted from a worker go to that worker's
+ * deque, other submissions are spread round robin.
+ *
+ * Each task runs in its own LocalFrame, its local references are freed when
+ * it returns. A java exception left pending by a task is cleared before the next task,
+ * a C++ exception thrown by a task is caught and dropped.
+ * shutdown() (or the destructor) must be called before VM::destroy().
+ * A task may call shutdown(), but must not delete its executor.
+ */
+class VmExecutor {
+ public:
+  typedef std::function<void(JNIEnv*)> Task;
+
+  struct Options {
+    /**
+     * 0 for std::thread::hardware_concurrency()
+     */
+    size_t thread_count;
+    /**
+     * java.lang.Thread names are "<prefix>-<index>", may be null
+     */
+    const char* thread_name_prefix;
+    bool daemon;
+    /**
+     * PushLocalFrame capacity of each task
+     */
+    jint local_capacity;
+
+    Options()
+        : thread_count(0), thread_name_prefix("jcu-jvm-worker"), daemon(true), local_capacity(16) {}
+  };
+
+  virtual ~VmExecutor() {}
+
+  /**
+   * @return false after shutdown() or if no worker could attach,
+   *         tasks running on a worker may still submit while shutdown() drains
+   */
+  virtual bool submit(Task task) = 0;
+
+  virtual size_t threadCount() const = 0;
+
+  /**
+   * number of workers that attached successfully
+   */
+  virtual size_t attachedCount() const = 0;
+
+  /**
+   * Stop accepting tasks, run the queued ones, detach and join the workers.
+   * Called from a task, the calling worker is left to the destructor.
+   */
+  virtual void shutdown() = 0;
+
+  /**
+   * Start the workers and wait until all of them attached (or failed to)
+   */
+  static VmExecutor* create(VM* vm, const Options& options = Options());
+};
+
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_VM_EXECUTOR_H_
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2020 jc-lab.
+ * This software may be modified and distributed under the terms
+ * of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+package net.jclab.jcu.jvm;
+
+import java.lang.invoke.MethodHandle;
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.MethodType;
+import java.lang.reflect.Method;
+import java.lang.reflect.Modifier;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Arrays;
+
+/**
+ * Executes the calls packed by jcu::jvm::CommandBatch (see command_batch.h
+ * for the record layout).
+ */
+public final class CommandBatchDispatcher {
+    private static final int HEADER_SIZE = 8;
+    private static final int FAILED_OFFSET = 4;
+    private static final int SLOT_SIZE = 8;
+    /**
+     * receiver ref index, relative to the first argument slot
+     */
+    private static final int RECEIVER_OFFSET = -4;
+
+    private static final MethodHandles.Lookup LOOKUP = MethodHandles.lookup();
+    private static final MethodType INVOKER_TYPE =
+            MethodType.methodType(void.class, ByteBuffer.class, int.class, Object[].class);
+
+    private static final class Op {
+        /**
+         * (ByteBuffer buffer, int slot, Object[] refs) void: reads the receiver and
+         * arguments of the record whose first argument slot is at slot, calls the
+         * method and stores its result, without allocating or boxing
+         */
+        final MethodHandle invoker;
+        /**
+         * argument slots plus the result slot
+         */
+        final int slots;
+
+        Op(MethodHandle invoker, int slots) {
+            this.invoker = invoker;
+            this.slots = slots;
+        }
+    }
+
+    private static volatile Op[] ops = new Op[0];
+
+    private CommandBatchDispatcher() {
+    }
+
+    public static synchronized int define(Method method) throws ReflectiveOperationException {
+        method.setAccessible(true);
+        Class<?>[] parameters = method.getParameterTypes();
+        int receivers = Modifier.isStatic(method.getModifiers()) ? 0 : 1;
+        MethodHandle target = LOOKUP.unreflect(method);
+
+        // every parameter, last first, becomes a reader (buffer, slot, refs) of its slot
+        for (int i = target.type().parameterCount() - 1; i >= 0; i--) {
+            MethodHandle reader = (i < receivers)
+                    ? reader(Object.class, RECEIVER_OFFSET)
+                    : reader(parameters[i - receivers], (i - receivers) * SLOT_SIZE);
+            reader = reader.asType(reader.type().changeReturnType(target.type().parameterType(i)));
+            target = MethodHandles.collectArguments(target, i, reader);
+        }
+        Class<?> result = method.getReturnType();
+        if (result != void.class) {
+            MethodHandle writer = writer(result, parameters.length * SLOT_SIZE);
+            target = target.asType(target.type().changeReturnType(writer.type().parameterType(0)));
+            target = MethodHandles.collectArguments(writer, 0, target);
+        }
+        // merge the (buffer, slot, refs) triples of all readers and the writer
+        int[] reorder = new int[target.type().parameterCount()];
+        for (int i = 0; i < reorder.length; i++) {
+            reorder[i] = i % 3;
+        }
+        MethodHandle invoker = MethodHandles.permuteArguments(target, INVOKER_TYPE, reorder);
+
+        Op[] table = Arrays.copyOf(ops, ops.length + 1);
+        table[ops.length] = new Op(invoker, parameters.length + 1);
+        ops = table;
+        return ops.length - 1;
+    }
+
+    public static int dispatch(ByteBuffer buffer, int count, Object[] refs) throws Throwable {
+        ByteBuffer b = buffer.order(ByteOrder.nativeOrder());
+        Op[] table = ops;
+        int position = HEADER_SIZE;
+        for (int i = 0; i < count; i++) {
+            Op op = table[b.getInt(position)];
+            int slot = position + 8;
+            b.putInt(FAILED_OFFSET, i);
+            op.invoker.invokeExact(b, slot, refs);
+            position = slot + op.slots * SLOT_SIZE;
+        }
+        return count;
+    }
+
+    /**
+     * (ByteBuffer buffer, int slot, Object[] refs) type, primitives read as is,
+     * objects (as Object) from refs at the index stored in the slot
+     */
+    private static MethodHandle reader(Class<?> type, int offset) throws ReflectiveOperationException {
+        Class<?> value = type.isPrimitive() ? type : Object.class;
+        MethodHandle handle = LOOKUP.findStatic(CommandBatchDispatcher.class, accessorName("read", type),
+                MethodType.methodType(value, ByteBuffer.class, int.class, int.class, Object[].class));
+        return MethodHandles.insertArguments(handle, 2, offset);
+    }
+
+    /**
+     * (type value, ByteBuffer buffer, int slot, Object[] refs) void
+     */
+    private static MethodHandle writer(Class<?> type, int offset) throws ReflectiveOperationException {
+        Class<?> value = type.isPrimitive() ? type : Object.class;
+        MethodHandle handle = LOOKUP.findStatic(CommandBatchDispatcher.class, accessorName("write", type),
+                MethodType.methodType(void.class, value, ByteBuffer.class, int.class, int.class, Object[].class));
+        return MethodHandles.insertArguments(handle, 3, offset);
+    }
+
+    private static String accessorName(String prefix, Class<?> type) {
+        if (!type.isPrimitive()) {
+            return prefix + "Ref";
+        }
+        String name = type.getName();
+        return prefix + Character.toUpperCase(name.charAt(0)) + name.substring(1);
+    }
+
+    private static Object readRef(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return refs[b.getInt(slot + offset)];
+    }
+
+    private static int readInt(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return b.getInt(slot + offset);
+    }
+
+    private static long readLong(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return b.getLong(slot + offset);
+    }
+
+    private static double readDouble(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return b.getDouble(slot + offset);
+    }
+
+    private static float readFloat(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return b.getFloat(slot + offset);
+    }
+
+    private static boolean readBoolean(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return b.get(slot + offset) != 0;
+    }
+
+    private static byte readByte(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return b.get(slot + offset);
+    }
+
+    private static char readChar(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return b.getChar(slot + offset);
+    }
+
+    private static short readShort(ByteBuffer b, int slot, int offset, Object[] refs) {
+        return b.getShort(slot + offset);
+    }
+
+    private static void writeRef(Object value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        refs[b.getInt(slot + offset)] = value;
+    }
+
+    private static void writeInt(int value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        b.putInt(slot + offset, value);
+    }
+
+    private static void writeLong(long value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        b.putLong(slot + offset, value);
+    }
+
+    private static void writeDouble(double value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        b.putDouble(slot + offset, value);
+    }
+
+    private static void writeFloat(float value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        b.putFloat(slot + offset, value);
+    }
+
+    private static void writeBoolean(boolean value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        b.put(slot + offset, (byte) (value ? 1 : 0));
+    }
+
+    private static void writeByte(byte value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        b.put(slot + offset, value);
+    }
+
+    private static void writeChar(char value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        b.putChar(slot + offset, value);
+    }
+
+    private static void writeShort(short value, ByteBuffer b, int slot, int offset, Object[] refs) {
+        b.putShort(slot + offset, value);
+    }
+}
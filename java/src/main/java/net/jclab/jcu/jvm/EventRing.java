@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2020 jc-lab.
+ * This software may be modified and distributed under the terms
+ * of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+package net.jclab.jcu.jvm;
+
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Java side of jcu::jvm::EventRing (see event_ring.h for the layout), requires java 9.
+ */
+public final class EventRing {
+    public interface Handler {
+        /**
+         * @param buffer the ring, the payload is [offset, offset + length) and only valid during the call
+         */
+        void onRecord(int type, ByteBuffer buffer, int offset, int length);
+    }
+
+    private static final int TAIL_OFFSET = 0;
+    private static final int HEAD_OFFSET = 128;
+    private static final int CLOSED_OFFSET = 192;
+    private static final int HEADER_SIZE = 256;
+    private static final int RECORD_HEADER_SIZE = 8;
+    private static final int PADDING_TYPE = -1;
+
+    private static final VarHandle LONGS = MethodHandles.byteBufferViewVarHandle(long[].class, ByteOrder.nativeOrder());
+    private static final VarHandle INTS = MethodHandles.byteBufferViewVarHandle(int[].class, ByteOrder.nativeOrder());
+
+    private final ByteBuffer buffer;
+    private final int capacity;
+
+    public EventRing(ByteBuffer buffer) {
+        this.buffer = buffer.duplicate().order(ByteOrder.nativeOrder());
+        this.capacity = buffer.capacity() - HEADER_SIZE;
+    }
+
+    public int maxPayloadSize() {
+        return capacity / 8 - RECORD_HEADER_SIZE;
+    }
+
+    public boolean isClosed() {
+        return (int) INTS.getAcquire(buffer, CLOSED_OFFSET) != 0;
+    }
+
+    public void close() {
+        INTS.setRelease(buffer, CLOSED_OFFSET, 1);
+    }
+
+    /**
+     * Consume committed records, only one consumer may read at a time
+     *
+     * @return number of records handled
+     */
+    public int read(Handler handler, int maxRecords) {
+        long head = (long) LONGS.getOpaque(buffer, HEAD_OFFSET);
+        int bytes = 0;
+        int count = 0;
+        while (count < maxRecords && bytes < capacity) {
+            int index = HEADER_SIZE + (int) ((head + bytes) & (capacity - 1));
+            int length = (int) INTS.getAcquire(buffer, index);
+            if (length <= 0) {
+                break;
+            }
+            int type = buffer.getInt(index + 4);
+            if (type != PADDING_TYPE) {
+                handler.onRecord(type, buffer, index + RECORD_HEADER_SIZE, length - RECORD_HEADER_SIZE);
+                count++;
+            }
+            bytes += align(length);
+        }
+        if (bytes > 0) {
+            for (int i = 0; i < bytes; i += 8) {
+                buffer.putLong(HEADER_SIZE + (int) ((head + i) & (capacity - 1)), 0L);
+            }
+            LONGS.setRelease(buffer, HEAD_OFFSET, head + bytes);
+        }
+        return count;
+    }
+
+    /**
+     * Write the remaining bytes of payload (its position is not changed)
+     *
+     * @param type >= 0
+     * @return false if the ring is full or the payload is larger than maxPayloadSize()
+     */
+    public boolean write(int type, ByteBuffer payload) {
+        int size = payload.remaining();
+        if (size > maxPayloadSize() || type < 0) {
+            return false;
+        }
+        int record = align(RECORD_HEADER_SIZE + size);
+        long head = (long) LONGS.getAcquire(buffer, HEAD_OFFSET);
+        long tail;
+        int offset;
+        int padding;
+        for (;;) {
+            tail = (long) LONGS.getVolatile(buffer, TAIL_OFFSET);
+            offset = (int) (tail & (capacity - 1));
+            padding = (record > capacity - offset) ? capacity - offset : 0;
+            int required = padding + record;
+            if (tail - head + required > capacity) {
+                head = (long) LONGS.getAcquire(buffer, HEAD_OFFSET);
+                if (tail - head + required > capacity) {
+                    return false;
+                }
+            }
+            if (LONGS.compareAndSet(buffer, TAIL_OFFSET, tail, tail + required)) {
+                break;
+            }
+        }
+        if (padding > 0) {
+            buffer.putInt(HEADER_SIZE + offset + 4, PADDING_TYPE);
+            INTS.setRelease(buffer, HEADER_SIZE + offset, padding);
+            offset = 0;
+        }
+        int index = HEADER_SIZE + offset;
+        buffer.putInt(index + 4, type);
+        ByteBuffer target = buffer.duplicate();
+        target.position(index + RECORD_HEADER_SIZE);
+        target.put(payload.duplicate());
+        INTS.setRelease(buffer, index, RECORD_HEADER_SIZE + size);
+        return true;
+    }
+
+    private static int align(int length) {
+        return (length + 7) & ~7;
+    }
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2020 jc-lab.
+ * This software may be modified and distributed under the terms
+ * of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+package net.jclab.jcu.jvm;
+
+import java.lang.invoke.MethodHandle;
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.MethodType;
+import java.lang.reflect.Array;
+import java.lang.reflect.Method;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+
+/**
+ * Native functions installed by jcu::jvm::ForeignFunctions and upcall stubs
+ * handed to native code (see foreign_function.h).
+ *
+ * java.lang.foreign (JDK 22+) is only reached through reflection so that
+ * this class also loads on older vms, where downcall() falls back to the
+ * JNI native method and registerUpcall() fails.
+ *
+ * <pre>
+ * static final MethodHandle CHECKSUM = ForeignBindings.downcall(MethodHandles.lookup(), "checksum",
+ *         MethodType.methodType(long.class, long.class, int.class));
+ * long sum = (long) CHECKSUM.invokeExact(address, length);
+ * </pre>
+ */
+public final class ForeignBindings {
+    private static final class Downcall {
+        final long address;
+        final String descriptor;
+        final boolean critical;
+
+        Downcall(long address, String descriptor, boolean critical) {
+            this.address = address;
+            this.descriptor = descriptor;
+            this.critical = critical;
+        }
+    }
+
+    private static final class Upcall {
+        final long address;
+        final String descriptor;
+
+        Upcall(long address, String descriptor) {
+            this.address = address;
+            this.descriptor = descriptor;
+        }
+    }
+
+    /**
+     * Reflective access to the foreign linker
+     */
+    private static final class Linker {
+        private final Object nativeLinker;
+        private final Method downcallHandle;
+        private final Method upcallStub;
+        private final Method ofAddress;
+        private final Method address;
+        private final Method functionOf;
+        private final Method functionOfVoid;
+        private final Method critical;
+        private final Class<?> layoutClass;
+        private final Class<?> optionClass;
+        private final Object arena;
+        private final Map<Class<?>, Object> layouts = new HashMap<>();
+
+        Linker() throws ReflectiveOperationException {
+            Class<?> linkerClass = Class.forName("java.lang.foreign.Linker");
+            Class<?> segmentClass = Class.forName("java.lang.foreign.MemorySegment");
+            Class<?> descriptorClass = Class.forName("java.lang.foreign.FunctionDescriptor");
+            Class<?> arenaClass = Class.forName("java.lang.foreign.Arena");
+            Class<?> valueLayoutClass = Class.forName("java.lang.foreign.ValueLayout");
+            layoutClass = Class.forName("java.lang.foreign.MemoryLayout");
+            optionClass = Class.forName("java.lang.foreign.Linker$Option");
+            Class<?> layoutArrayClass = Array.newInstance(layoutClass, 0).getClass();
+            Class<?> optionArrayClass = Array.newInstance(optionClass, 0).getClass();
+
+            nativeLinker = linkerClass.getMethod("nativeLinker").invoke(null);
+            downcallHandle = linkerClass.getMethod("downcallHandle", segmentClass, descriptorClass, optionArrayClass);
+            upcallStub = linkerClass.getMethod("upcallStub", MethodHandle.class, descriptorClass, arenaClass, optionArrayClass);
+            ofAddress = segmentClass.getMethod("ofAddress", long.class);
+            address = segmentClass.getMethod("address");
+            functionOf = descriptorClass.getMethod("of", layoutClass, layoutArrayClass);
+            functionOfVoid = descriptorClass.getMethod("ofVoid", layoutArrayClass);
+            Method criticalOption;
+            try {
+                criticalOption = optionClass.getMethod("critical", boolean.class);
+            } catch (NoSuchMethodException e) {
+                criticalOption = null;
+            }
+            critical = criticalOption;
+            // upcall stubs live until the vm exits, native code may keep them
+            arena = arenaClass.getMethod("global").invoke(null);
+
+            layouts.put(boolean.class, valueLayoutClass.getField("JAVA_BOOLEAN").get(null));
+            layouts.put(byte.class, valueLayoutClass.getField("JAVA_BYTE").get(null));
+            layouts.put(char.class, valueLayoutClass.getField("JAVA_CHAR").get(null));
+            layouts.put(short.class, valueLayoutClass.getField("JAVA_SHORT").get(null));
+            layouts.put(int.class, valueLayoutClass.getField("JAVA_INT").get(null));
+            layouts.put(long.class, valueLayoutClass.getField("JAVA_LONG").get(null));
+            layouts.put(float.class, valueLayoutClass.getField("JAVA_FLOAT").get(null));
+            layouts.put(double.class, valueLayoutClass.getField("JAVA_DOUBLE").get(null));
+        }
+
+        private Object layoutOf(Class<?> type) {
+            Object layout = layouts.get(type);
+            if (layout == null) {
+                throw new IllegalArgumentException("not a java primitive: " + type);
+            }
+            return layout;
+        }
+
+        private Object functionDescriptor(MethodType type) throws ReflectiveOperationException {
+            Object parameters = Array.newInstance(layoutClass, type.parameterCount());
+            for (int i = 0; i < type.parameterCount(); i++) {
+                Array.set(parameters, i, layoutOf(type.parameterType(i)));
+            }
+            if (type.returnType() == void.class) {
+                return functionOfVoid.invoke(null, parameters);
+            }
+            return functionOf.invoke(null, layoutOf(type.returnType()), parameters);
+        }
+
+        MethodHandle downcall(Downcall entry) throws ReflectiveOperationException {
+            MethodType type = MethodType.fromMethodDescriptorString(entry.descriptor, null);
+            Object options = Array.newInstance(optionClass, (entry.critical && critical != null) ? 1 : 0);
+            if (Array.getLength(options) > 0) {
+                Array.set(options, 0, critical.invoke(null, false));
+            }
+            Object segment = ofAddress.invoke(null, entry.address);
+            return (MethodHandle) downcallHandle.invoke(nativeLinker, segment, functionDescriptor(type), options);
+        }
+
+        long upcall(MethodHandle target) throws ReflectiveOperationException {
+            Object options = Array.newInstance(optionClass, 0);
+            Object stub = upcallStub.invoke(nativeLinker, target, functionDescriptor(target.type()), arena, options);
+            return (Long) address.invoke(stub);
+        }
+    }
+
+    private static final Linker LINKER = createLinker();
+
+    private static final Map<Class<?>, Map<String, Downcall>> downcalls = new ConcurrentHashMap<>();
+    private static final Map<String, Upcall> upcalls = new ConcurrentHashMap<>();
+
+    private ForeignBindings() {
+    }
+
+    private static Linker createLinker() {
+        try {
+            // java.lang.foreign is a preview api in JDK 21, Runtime.version() needs JDK 10
+            if (Runtime.version().feature() < 22) {
+                return null;
+            }
+            return new Linker();
+        } catch (Throwable e) {
+            // before JDK 10 or without native access
+            return null;
+        }
+    }
+
+    /**
+     * Whether the foreign linker is used
+     */
+    public static boolean available() {
+        return LINKER != null;
+    }
+
+    /**
+     * Handle of the native function name installed for the caller class
+     * (lookup.lookupClass()): a downcall handle with the foreign linker,
+     * otherwise the static native method of the same name.
+     */
+    public static MethodHandle downcall(MethodHandles.Lookup lookup, String name, MethodType type)
+            throws ReflectiveOperationException {
+        Class<?> owner = lookup.lookupClass();
+        Map<String, Downcall> functions = downcalls.get(owner);
+        Downcall entry = (functions != null) ? functions.get(name) : null;
+        if (LINKER != null && entry != null) {
+            return LINKER.downcall(entry).asType(type);
+        }
+        return lookup.findStatic(owner, name, type);
+    }
+
+    /**
+     * Create an upcall stub of target (primitive parameters and result only),
+     * native code gets it with ForeignFunctions::upcall&lt;F&gt;(env, name).
+     * @return false without the foreign linker
+     */
+    public static boolean registerUpcall(String name, MethodHandle target) throws ReflectiveOperationException {
+        if (LINKER == null) {
+            return false;
+        }
+        long address = LINKER.upcall(target);
+        upcalls.put(name, new Upcall(address, target.type().toMethodDescriptorString()));
+        return true;
+    }
+
+    static void registerDowncall(Class<?> owner, String name, long address, String descriptor, boolean critical) {
+        downcalls.computeIfAbsent(owner, key -> new ConcurrentHashMap<>())
+                .put(name, new Downcall(address, descriptor, critical));
+    }
+
+    static long upcallAddress(String name, String descriptor) {
+        Upcall entry = upcalls.get(name);
+        if (entry == null || !entry.descriptor.equals(descriptor)) {
+            return 0;
+        }
+        return entry.address;
+    }
+}
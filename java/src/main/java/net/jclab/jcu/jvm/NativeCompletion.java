@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2020 jc-lab.
+ * This software may be modified and distributed under the terms
+ * of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+package net.jclab.jcu.jvm;
+
+import java.util.function.BiConsumer;
+
+/**
+ * Completion of a CompletionStage delivered to jcu::jvm::JavaFutures::whenComplete()
+ */
+public final class NativeCompletion implements BiConsumer<Object, Throwable> {
+    private final long handle;
+
+    public NativeCompletion(long handle) {
+        this.handle = handle;
+    }
+
+    @Override
+    public void accept(Object value, Throwable error) {
+        complete(handle, value, error);
+    }
+
+    private static native void complete(long handle, Object value, Throwable error);
+}
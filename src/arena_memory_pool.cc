@@ -0,0 +1,164 @@
+/**
+ * @file	arena_memory_pool.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/14
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena_memory_pool.h"
+
+namespace jcu {
+namespace jvm {
+
+ArenaMemoryPool* createArenaMemoryPool(const ArenaMemoryPool::Options& options) {
+  return new intl::ArenaMemoryPoolImpl(options);
+}
+
+namespace intl {
+
+ArenaMemoryPoolImpl::ArenaMemoryPoolImpl(const Options& options)
+    : inline_chunk_(nullptr), head_(nullptr), cursor_(1), limit_(0),
+      last_ptr_(nullptr), last_cursor_(0), last_size_(0) {
+  memset(&stats_, 0, sizeof(stats_));
+
+  alignment_ = 1;
+  while (alignment_ < options.alignment) {
+    alignment_ <<= 1;
+  }
+  chunk_size_ = (options.chunk_size < 64) ? 64 : options.chunk_size;
+
+  if (options.inline_block) {
+    uintptr_t begin = alignUp((uintptr_t) options.inline_block, alignof(Chunk));
+    uintptr_t end = (uintptr_t) options.inline_block + options.inline_block_size;
+    if (end > begin && (end - begin) > sizeof(Chunk)) {
+      inline_chunk_ = (Chunk*) begin;
+      inline_chunk_->next = nullptr;
+      inline_chunk_->size = end - begin - sizeof(Chunk);
+      inline_chunk_->heap = false;
+      head_ = inline_chunk_;
+      stats_.bytes_reserved = inline_chunk_->size;
+      stats_.chunk_count = 1;
+      useChunk(inline_chunk_);
+    }
+  }
+}
+
+ArenaMemoryPoolImpl::~ArenaMemoryPoolImpl() {
+  Chunk* chunk = head_;
+  while (chunk) {
+    Chunk* next = chunk->next;
+    if (chunk->heap) {
+      ::free(chunk);
+    }
+    chunk = next;
+  }
+}
+
+ArenaMemoryPoolImpl::Chunk* ArenaMemoryPoolImpl::newHeapChunk(size_t data_size) {
+  Chunk* chunk = (Chunk*) ::malloc(sizeof(Chunk) + data_size);
+  if (!chunk) {
+    return nullptr;
+  }
+  chunk->next = nullptr;
+  chunk->size = data_size;
+  chunk->heap = true;
+  stats_.bytes_reserved += data_size;
+  stats_.chunk_count++;
+  return chunk;
+}
+
+void ArenaMemoryPoolImpl::useChunk(Chunk* chunk) {
+  cursor_ = chunkBegin(chunk);
+  limit_ = cursor_ + chunk->size;
+}
+
+void* ArenaMemoryPoolImpl::allocateSlow(size_t size) {
+  if (size > chunk_size_ / 2 || size + alignment_ - 1 > chunk_size_) {
+    // dedicated chunk, linked behind the current one so bumping continues there.
+    // Also when the alignment padding could leave a fresh chunk too short.
+    Chunk* chunk = newHeapChunk(size + alignment_);
+    if (!chunk) {
+      return nullptr;
+    }
+    if (head_) {
+      chunk->next = head_->next;
+      head_->next = chunk;
+    } else {
+      // keep the bump chunk at head_: this one is full already
+      head_ = chunk;
+      cursor_ = 1;
+      limit_ = 0;
+    }
+    uintptr_t ptr = alignUp(chunkBegin(chunk), alignment_);
+    stats_.bytes_used += size;
+    stats_.bytes_wasted += chunk->size - size;
+    last_ptr_ = nullptr;
+    return (void*) ptr;
+  }
+
+  Chunk* chunk = newHeapChunk(chunk_size_);
+  if (!chunk) {
+    return nullptr;
+  }
+  if (limit_ > cursor_) {
+    stats_.bytes_wasted += limit_ - cursor_;
+  }
+  chunk->next = head_;
+  head_ = chunk;
+  useChunk(chunk);
+  return allocate(size);
+}
+
+bool ArenaMemoryPoolImpl::release(void *ptr) {
+  if (!ptr || ptr != last_ptr_) {
+    return false;
+  }
+  stats_.bytes_used -= last_size_;
+  stats_.bytes_wasted -= (uintptr_t) ptr - last_cursor_;
+  cursor_ = last_cursor_;
+  last_ptr_ = nullptr;
+  return true;
+}
+
+void ArenaMemoryPoolImpl::releaseAll() {
+  // Keep one chunk so that a pool reused per request does not hit malloc again.
+  Chunk* retained = inline_chunk_;
+  Chunk* chunk = head_;
+  while (chunk) {
+    Chunk* next = chunk->next;
+    if (chunk != inline_chunk_) {
+      if (!retained && chunk->size == chunk_size_) {
+        retained = chunk;
+      } else {
+        ::free(chunk);
+      }
+    }
+    chunk = next;
+  }
+
+  memset(&stats_, 0, sizeof(stats_));
+  last_ptr_ = nullptr;
+  head_ = retained;
+  if (retained) {
+    retained->next = nullptr;
+    stats_.bytes_reserved = retained->size;
+    stats_.chunk_count = 1;
+    useChunk(retained);
+  } else {
+    cursor_ = 1;
+    limit_ = 0;
+  }
+}
+
+ArenaMemoryPool::Stats ArenaMemoryPoolImpl::getStats() const {
+  return stats_;
+}
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,88 @@
+/**
+ * @file	arena_memory_pool.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/14
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_ARENA_MEMORY_POOL_H_
+#define JCU_JVM_SRC_ARENA_MEMORY_POOL_H_
+
+#include <stdint.h>
+
+#include <jcu-jvm/memory_pool.h>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+class ArenaMemoryPoolImpl : public ArenaMemoryPool {
+ private:
+  struct Chunk {
+    Chunk* next;
+    size_t size;
+    bool heap;
+  };
+
+  size_t chunk_size_;
+  size_t alignment_;
+  Chunk* inline_chunk_;
+
+  /**
+   * current bump chunk is always head_
+   */
+  Chunk* head_;
+  uintptr_t cursor_;
+  uintptr_t limit_;
+
+  /**
+   * for rewinding the most recent allocation
+   */
+  void* last_ptr_;
+  uintptr_t last_cursor_;
+  size_t last_size_;
+
+  Stats stats_;
+
+  static uintptr_t alignUp(uintptr_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  }
+
+  static uintptr_t chunkBegin(Chunk* chunk) {
+    return (uintptr_t)(chunk + 1);
+  }
+
+  Chunk* newHeapChunk(size_t data_size);
+  void useChunk(Chunk* chunk);
+  void* allocateSlow(size_t size);
+
+ public:
+  explicit ArenaMemoryPoolImpl(const Options& options);
+  ~ArenaMemoryPoolImpl();
+
+  void* allocate(size_t size) override {
+    uintptr_t ptr = alignUp(cursor_, alignment_);
+    if (ptr <= limit_ && size <= limit_ - ptr) {
+      last_ptr_ = (void*) ptr;
+      last_cursor_ = cursor_;
+      last_size_ = size;
+      stats_.bytes_wasted += ptr - cursor_;
+      stats_.bytes_used += size;
+      cursor_ = ptr + size;
+      return (void*) ptr;
+    }
+    return allocateSlow(size);
+  }
+
+  bool release(void *ptr) override;
+  void releaseAll() override;
+  Stats getStats() const override;
+};
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif // JCU_JVM_SRC_ARENA_MEMORY_POOL_H_
@@ -0,0 +1,62 @@
+/**
+ * @file	builtin_dso_handle.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/26
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_BUILTIN_DSO_HANDLE_H_
+#define JCU_JVM_SRC_BUILTIN_DSO_HANDLE_H_
+
+#include <list>
+#include <string>
+
+#include <jcu-jvm/os_handler.h>
+#include <jcu-jvm/builtin_library.h>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+/**
+ * DsoHandle of a library registered in BuiltinLibraries.
+ *
+ * Nothing is loaded, open() only checks that the process image exports
+ * JNI_OnLoad_<name> where the vm looks for it. The JNI_OnLoad / JNI_OnUnload
+ * entry points resolve to the registered functions, other symbols are looked
+ * up in the process image.
+ */
+class BuiltinDsoHandle : public DsoHandle {
+ private:
+  const OsHandler* os_handler_;
+  BuiltinLibraries::Library library_;
+  bool loaded_;
+  int errno_;
+  std::string error_;
+
+  std::list<PointerRef<DsoHandle>> dependencies_;
+
+ public:
+  explicit BuiltinDsoHandle(const OsHandler* os_handler);
+
+  void addDependency(PointerRef<DsoHandle>&& handle) override;
+
+  /**
+   * @param path registered library name
+   */
+  int open(const char* path) override;
+  bool isLoaded() const override;
+  int getErrno() const override;
+  const char* getError() const override;
+  void* getProc(const char* name) const override;
+  void close() override;
+  const char* getPath() const override;
+};
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif //JCU_JVM_SRC_BUILTIN_DSO_HANDLE_H_
@@ -0,0 +1,154 @@
+/**
+ * @file	builtin_library.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/26
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <map>
+#include <mutex>
+
+#include <jcu-jvm/builtin_library.h>
+
+#include "builtin_dso_handle.h"
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+
+/**
+ * Registrations run from static initializers, so the table is built on first use
+ */
+struct BuiltinTable {
+  std::mutex mutex;
+  std::map<std::string, BuiltinLibraries::Library> libraries;
+};
+
+BuiltinTable& builtinTable() {
+  static BuiltinTable table;
+  return table;
+}
+
+} // namespace
+
+bool BuiltinLibraries::add(const char* name, JniOnLoadFn on_load, JniOnUnloadFn on_unload) {
+  if (!name || !*name || !on_load) {
+    return false;
+  }
+  BuiltinTable& table = builtinTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  Library library;
+  library.name = name;
+  library.on_load = on_load;
+  library.on_unload = on_unload;
+  return table.libraries.emplace(library.name, library).second;
+}
+
+bool BuiltinLibraries::find(const char* name, Library* library) {
+  if (!name) {
+    return false;
+  }
+  BuiltinTable& table = builtinTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  auto it = table.libraries.find(name);
+  if (it == table.libraries.end()) {
+    return false;
+  }
+  if (library) {
+    *library = it->second;
+  }
+  return true;
+}
+
+std::vector<std::string> BuiltinLibraries::names() {
+  BuiltinTable& table = builtinTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  std::vector<std::string> result;
+  result.reserve(table.libraries.size());
+  for (const auto& item : table.libraries) {
+    result.push_back(item.first);
+  }
+  return result;
+}
+
+std::string BuiltinLibraries::onLoadSymbol(const char* name) {
+  return std::string("JNI_OnLoad_") + name;
+}
+
+std::string BuiltinLibraries::onUnloadSymbol(const char* name) {
+  return std::string("JNI_OnUnload_") + name;
+}
+
+namespace intl {
+
+BuiltinDsoHandle::BuiltinDsoHandle(const OsHandler* os_handler)
+    : os_handler_(os_handler), loaded_(false), errno_(0) {
+  library_.on_load = nullptr;
+  library_.on_unload = nullptr;
+}
+
+void BuiltinDsoHandle::addDependency(PointerRef<DsoHandle>&& handle) {
+  dependencies_.emplace_back(std::move(handle));
+}
+
+int BuiltinDsoHandle::open(const char* path) {
+  close();
+  errno_ = 0;
+  error_.clear();
+  if (!BuiltinLibraries::find(path, &library_)) {
+    errno_ = ENOENT;
+    error_ = std::string(path ? path : "") + " is not a builtin library";
+    return errno_;
+  }
+  if (!os_handler_->getProcessSymbol(BuiltinLibraries::onLoadSymbol(path).c_str())) {
+    errno_ = ENOENT;
+    error_ = BuiltinLibraries::onLoadSymbol(path) + " is not exported by the executable";
+    return errno_;
+  }
+  loaded_ = true;
+  return 0;
+}
+
+bool BuiltinDsoHandle::isLoaded() const {
+  return loaded_;
+}
+
+int BuiltinDsoHandle::getErrno() const {
+  return errno_;
+}
+
+const char* BuiltinDsoHandle::getError() const {
+  return error_.c_str();
+}
+
+void* BuiltinDsoHandle::getProc(const char* name) const {
+  if (!loaded_) {
+    return nullptr;
+  }
+  if (!strcmp(name, "JNI_OnLoad") || BuiltinLibraries::onLoadSymbol(library_.name.c_str()) == name) {
+    return (void*) library_.on_load;
+  }
+  if (!strcmp(name, "JNI_OnUnload") || BuiltinLibraries::onUnloadSymbol(library_.name.c_str()) == name) {
+    return (void*) library_.on_unload;
+  }
+  return os_handler_->getProcessSymbol(name);
+}
+
+void BuiltinDsoHandle::close() {
+  loaded_ = false;
+}
+
+const char* BuiltinDsoHandle::getPath() const {
+  return library_.name.c_str();
+}
+
+} // namespace intl
+
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,130 @@
+/**
+ * @file	cds_archive.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/18
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <fstream>
+
+#include "cds_archive.h"
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+static uint64_t fnv1a64(const std::string& text) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (auto it = text.cbegin(); it != text.cend(); it++) {
+    hash ^= (unsigned char) *it;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static std::string serializeKey(const CdsArchiveKey& key) {
+  return key.jvm_path + "\t" + key.jvm_fingerprint + "\t" + key.classpath;
+}
+
+static bool isStorable(const std::string& value) {
+  return value.find_first_of("\t\r\n") == std::string::npos;
+}
+
+static bool fileExists(const std::string& path) {
+  FILE* fp = ::fopen(path.c_str(), "rb");
+  if (!fp) {
+    return false;
+  }
+  ::fclose(fp);
+  return true;
+}
+
+static bool writeFile(const std::string& path, const std::string& content, const std::string& temp_suffix) {
+  std::string temp_path(path + ".tmp." + temp_suffix);
+  {
+    std::ofstream file(temp_path.c_str(), std::ios::out | std::ios::trunc);
+    file << content << '\n';
+    file.flush();
+    if (!file) {
+      file.close();
+      ::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  if (::rename(temp_path.c_str(), path.c_str()) != 0) {
+    // windows does not replace an existing file
+    ::remove(path.c_str());
+    if (::rename(temp_path.c_str(), path.c_str()) != 0) {
+      ::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+CdsArchive::Mode CdsArchive::prepare(const CdsArchiveKey& key, const std::string& temp_suffix, std::string* option) const {
+  option->clear();
+  if (dir_.empty() || key.jvm_fingerprint.empty()
+      || !isStorable(key.classpath) || !isStorable(key.jvm_path) || !isStorable(key.jvm_fingerprint)) {
+    return kModeNone;
+  }
+
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.jsa", (unsigned long long) fnv1a64(key.classpath));
+  std::string archive_path(dir_);
+  char last = archive_path.back();
+  if (last != '/' && last != '\\') {
+    archive_path.push_back('/');
+  }
+  archive_path.append(name);
+  std::string key_path(archive_path + ".key");
+  std::string expected = serializeKey(key);
+
+  std::string stored;
+  {
+    std::ifstream file(key_path.c_str());
+    std::getline(file, stored);
+  }
+
+  if (stored == expected && fileExists(archive_path)) {
+    *option = "-XX:SharedArchiveFile=" + archive_path;
+    return kModeUse;
+  }
+
+  // stale (other jvm, hash collision) or never finished training
+  ::remove(archive_path.c_str());
+  if (stored != expected && !writeFile(key_path, expected, temp_suffix)) {
+    return kModeNone;
+  }
+  *option = "-XX:ArchiveClassesAtExit=" + archive_path;
+  return kModeTrain;
+}
+
+bool CdsArchive::isUserManaged(const char* option_string) {
+  static const char* prefixes[] = {
+      "-XX:SharedArchiveFile",
+      "-XX:ArchiveClassesAtExit",
+      "-XX:+AutoCreateSharedArchive",
+      "-XX:SharedClassListFile",
+      "-Xshare:",
+  };
+  if (!option_string) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+    if (strncmp(option_string, prefixes[i], strlen(prefixes[i])) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
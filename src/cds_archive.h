@@ -0,0 +1,77 @@
+/**
+ * @file	cds_archive.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/18
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_CDS_ARCHIVE_H_
+#define JCU_JVM_SRC_CDS_ARCHIVE_H_
+
+#include <string>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+/**
+ * Identity of an AppCDS archive
+ */
+struct CdsArchiveKey {
+  std::string classpath;
+  std::string jvm_path;
+  /**
+   * platform specific identity of jvm_path (see OsHandler::getFileFingerprint()),
+   * changes with the jvm version
+   */
+  std::string jvm_fingerprint;
+};
+
+/**
+ * AppCDS archives of one directory.
+ *
+ * Each classpath owns "<hash>.jsa" and "<hash>.jsa.key", the key file holds
+ * the CdsArchiveKey the archive was trained with (tab separated, one line).
+ * An archive whose key no longer matches is removed and trained again.
+ */
+class CdsArchive {
+ public:
+  enum Mode {
+    kModeNone = 0,
+    /**
+     * no valid archive, dump one at exit (-XX:ArchiveClassesAtExit)
+     */
+    kModeTrain,
+    /**
+     * map the archive (-XX:SharedArchiveFile)
+     */
+    kModeUse,
+  };
+
+ private:
+  std::string dir_;
+
+ public:
+  explicit CdsArchive(const std::string& dir) : dir_(dir) {}
+
+  /**
+   * Validate the archive of key and return the vm option to add.
+   * @param temp_suffix unique per process, e.g. the pid
+   * @param option      set to the -XX option, empty for kModeNone
+   */
+  Mode prepare(const CdsArchiveKey& key, const std::string& temp_suffix, std::string* option) const;
+
+  /**
+   * true if the user options already control CDS
+   * (-XX:SharedArchiveFile, -XX:ArchiveClassesAtExit, -Xshare:off...)
+   */
+  static bool isUserManaged(const char* option_string);
+};
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif // JCU_JVM_SRC_CDS_ARCHIVE_H_
@@ -0,0 +1,315 @@
+/**
+ * @file	command_batch.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/27
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <jcu-jvm/command_batch.h>
+#include <jcu-jvm/id_registry.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+JCU_JVM_CLASS_KEY(CommandBatchDispatcherClass, "net/jclab/jcu/jvm/CommandBatchDispatcher");
+JCU_JVM_STATIC_METHOD_KEY(CommandBatchDispatcherDefine, CommandBatchDispatcherClass, "define", "(Ljava/lang/reflect/Method;)I");
+JCU_JVM_STATIC_METHOD_KEY(CommandBatchDispatcherDispatch, CommandBatchDispatcherClass, "dispatch", "(Ljava/nio/ByteBuffer;I[Ljava/lang/Object;)I");
+JCU_JVM_CLASS_KEY(JavaLangObject, "java/lang/Object");
+
+/**
+ * int32 count, int32 index of the call that threw
+ */
+const size_t kHeaderSize = 8;
+const size_t kSlotSize = 8;
+
+/**
+ * @param param_types set to the descriptor char of every parameter ('L' for references)
+ * @return false if signature is not a method descriptor
+ */
+bool parseDescriptor(const char* signature, std::string* param_types, bool* object_result) {
+  const char* p = signature;
+  if (*p++ != '(') {
+    return false;
+  }
+  std::string types;
+  while (*p && *p != ')') {
+    if (*p == '[' || *p == 'L') {
+      types.push_back('L');
+    } else {
+      types.push_back(*p);
+    }
+    while (*p == '[') {
+      p++;
+    }
+    if (*p == 'L') {
+      while (*p && *p != ';') {
+        p++;
+      }
+    }
+    if (!*p) {
+      return false;
+    }
+    p++;
+  }
+  if (*p++ != ')' || !*p) {
+    return false;
+  }
+  *param_types = std::move(types);
+  *object_result = (*p == 'L' || *p == '[');
+  return true;
+}
+} // namespace
+
+class CommandBatchImpl : public CommandBatch {
+ private:
+  struct OpInfo {
+    jint java_op;
+    std::string param_types;
+    bool object_result;
+    bool is_static;
+  };
+
+  Options options_;
+  std::unique_ptr<uint64_t[]> memory_;
+  size_t capacity_;
+
+  jobject buffer_;
+  jobjectArray refs_;
+
+  std::vector<OpInfo> ops_;
+
+  /**
+   * offset of the result slot of every appended call
+   */
+  std::vector<size_t> records_;
+  size_t used_;
+  jint ref_count_;
+  bool flushed_;
+
+  /**
+   * state before the last appendRecord(), restored by dropRecord()
+   */
+  size_t last_used_;
+  jint last_ref_count_;
+
+  uint8_t* base() const {
+    return (uint8_t*) memory_.get();
+  }
+
+  bool ensureCreated(JNIEnv* env) {
+    if (buffer_) {
+      return true;
+    }
+    jclass object_class = IdRegistry::getClass<JavaLangObject>(env);
+    if (!object_class) {
+      return false;
+    }
+    jobjectArray refs = env->NewObjectArray(options_.max_refs, object_class, nullptr);
+    if (!refs) {
+      return false;
+    }
+    jobject buffer = env->NewDirectByteBuffer(base(), (jlong) capacity_);
+    if (!buffer) {
+      env->DeleteLocalRef(refs);
+      return false;
+    }
+    refs_ = (jobjectArray) env->NewGlobalRef(refs);
+    buffer_ = env->NewGlobalRef(buffer);
+    env->DeleteLocalRef(refs);
+    env->DeleteLocalRef(buffer);
+    if (!refs_ || !buffer_) {
+      destroy(env);
+      return false;
+    }
+    return true;
+  }
+
+ public:
+  explicit CommandBatchImpl(const Options& options)
+      : options_(options), buffer_(nullptr), refs_(nullptr),
+        used_(kHeaderSize), ref_count_(0), flushed_(false), last_used_(kHeaderSize), last_ref_count_(0) {
+    capacity_ = (options_.buffer_size + 7) & ~(size_t) 7;
+    if (capacity_ < kHeaderSize) {
+      capacity_ = kHeaderSize;
+    }
+    memory_.reset(new uint64_t[capacity_ / 8]());
+  }
+
+  ~CommandBatchImpl() override {
+    // without an env the global references can only be leaked
+  }
+
+  Op define(JNIEnv* env, jclass clazz, const char* name, const char* signature, bool is_static) override {
+    OpInfo info;
+    info.is_static = is_static;
+    if (!parseDescriptor(signature, &info.param_types, &info.object_result)) {
+      return -1;
+    }
+    jmethodID define_method = IdRegistry::getMethod<CommandBatchDispatcherDefine>(env);
+    if (!define_method || !ensureCreated(env)) {
+      return -1;
+    }
+    jmethodID method = is_static ? env->GetStaticMethodID(clazz, name, signature) : env->GetMethodID(clazz, name, signature);
+    if (!method) {
+      return -1;
+    }
+    jobject reflected = env->ToReflectedMethod(clazz, method, is_static ? JNI_TRUE : JNI_FALSE);
+    if (!reflected) {
+      return -1;
+    }
+    info.java_op = env->CallStaticIntMethod(IdRegistry::getClass<CommandBatchDispatcherClass>(env), define_method, reflected);
+    env->DeleteLocalRef(reflected);
+    if (env->ExceptionCheck()) {
+      return -1;
+    }
+    ops_.push_back(info);
+    return (Op) (ops_.size() - 1);
+  }
+
+  size_t flush(JNIEnv* env, JavaError* error) override {
+    size_t count = records_.size();
+    if (!count || flushed_) {
+      return flushed_ ? count : 0;
+    }
+    jmethodID dispatch = IdRegistry::getMethod<CommandBatchDispatcherDispatch>(env);
+    if (!dispatch) {
+      JavaExceptions::take(env, error);
+      return 0;
+    }
+    int32_t header[2] = {(int32_t) count, 0};
+    memcpy(base(), header, sizeof(header));
+    flushed_ = true;
+    env->CallStaticIntMethod(IdRegistry::getClass<CommandBatchDispatcherClass>(env), dispatch, buffer_, (jint) count, refs_);
+    if (JavaExceptions::take(env, error)) {
+      memcpy(header, base(), sizeof(header));
+      return (size_t) header[1];
+    }
+    return count;
+  }
+
+  size_t size() const override {
+    return records_.size();
+  }
+
+  void reset(JNIEnv* env) override {
+    clearRefs(env, 0);
+    records_.clear();
+    used_ = kHeaderSize;
+    ref_count_ = 0;
+    flushed_ = false;
+  }
+
+  void destroy(JNIEnv* env) override {
+    reset(env);
+    if (buffer_) {
+      env->DeleteGlobalRef(buffer_);
+      buffer_ = nullptr;
+    }
+    if (refs_) {
+      env->DeleteGlobalRef(refs_);
+      refs_ = nullptr;
+    }
+  }
+
+ protected:
+  uint8_t* appendRecord(JNIEnv* env, Op op, jobject receiver, const char* arg_types) override {
+    if (flushed_) {
+      reset(env);
+    }
+    if (op < 0 || (size_t) op >= ops_.size() || !buffer_) {
+      return nullptr;
+    }
+    const OpInfo& info = ops_[op];
+    if (info.param_types != arg_types || info.is_static != (receiver == nullptr)) {
+      return nullptr;
+    }
+    size_t arg_count = info.param_types.size();
+    size_t record_size = 8 + arg_count * kSlotSize + kSlotSize;
+    if (used_ + record_size > capacity_) {
+      return nullptr;
+    }
+
+    last_used_ = used_;
+    last_ref_count_ = ref_count_;
+
+    int32_t header[2] = {info.java_op, -1};
+    if (receiver) {
+      header[1] = putRef(env, receiver);
+      if (header[1] < 0) {
+        return nullptr;
+      }
+    }
+    jint result_ref = -1;
+    if (info.object_result) {
+      if (ref_count_ >= options_.max_refs) {
+        clearRefs(env, last_ref_count_);
+        return nullptr;
+      }
+      // written by the dispatcher
+      result_ref = ref_count_++;
+    }
+
+    uint8_t* record = base() + used_;
+    memcpy(record, header, sizeof(header));
+    size_t result_offset = used_ + 8 + arg_count * kSlotSize;
+    memset(base() + result_offset, 0, kSlotSize);
+    memcpy(base() + result_offset, &result_ref, sizeof(result_ref));
+    records_.push_back(result_offset);
+    used_ += record_size;
+    return record + 8;
+  }
+
+  void dropRecord(JNIEnv* env) override {
+    records_.pop_back();
+    used_ = last_used_;
+    clearRefs(env, last_ref_count_);
+  }
+
+  /**
+   * Release the references of the table from index on
+   */
+  void clearRefs(JNIEnv* env, jint index) {
+    if (refs_) {
+      for (jint i = index; i < ref_count_; i++) {
+        env->SetObjectArrayElement(refs_, i, nullptr);
+      }
+    }
+    ref_count_ = index;
+  }
+
+  jint putRef(JNIEnv* env, jobject obj) override {
+    if (ref_count_ >= options_.max_refs) {
+      return -1;
+    }
+    env->SetObjectArrayElement(refs_, ref_count_, obj);
+    return ref_count_++;
+  }
+
+  jobject getRef(JNIEnv* env, jint index) const override {
+    if (index < 0 || index >= ref_count_) {
+      return nullptr;
+    }
+    return env->GetObjectArrayElement(refs_, index);
+  }
+
+  const uint8_t* resultSlot(size_t index) const override {
+    if (!flushed_ || index >= records_.size()) {
+      return nullptr;
+    }
+    return base() + records_[index];
+  }
+};
+
+CommandBatch* CommandBatch::create(const Options& options) {
+  return new CommandBatchImpl(options);
+}
+
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,382 @@
+/**
+ * @file	concurrent_memory_pool.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/15
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <unordered_map>
+
+#include "concurrent_memory_pool.h"
+#include "thread_key.h"
+
+namespace jcu {
+namespace jvm {
+
+MemoryPool* createConcurrentMemoryPool() {
+  return new intl::ConcurrentMemoryPool();
+}
+
+namespace intl {
+
+namespace {
+
+const uint32_t kStateFree = 0x46524545;
+const uint32_t kStateAllocated = 0x414c4c43;
+const uint32_t kLargeClass = 0xffffffff;
+
+const int kThreadCacheWays = 4;
+
+std::atomic<uint64_t> s_last_tag(0);
+
+/**
+ * Live pools by tag, for flushing thread caches
+ */
+struct PoolRegistry {
+  std::mutex mutex;
+  std::unordered_map<uint64_t, ConcurrentMemoryPool*> pools;
+};
+
+PoolRegistry* poolRegistry() {
+  // Never deleted: threads may still exit after static destruction.
+  static PoolRegistry* registry = new PoolRegistry();
+  return registry;
+}
+
+struct ThreadCaches {
+  ConcurrentMemoryPool::ThreadCache ways[kThreadCacheWays];
+  unsigned int next_victim;
+};
+
+thread_local ThreadCaches* t_caches = nullptr;
+
+void onThreadExit(void* value) {
+  ThreadCaches* caches = (ThreadCaches*) value;
+  for (int i = 0; i < kThreadCacheWays; i++) {
+    ConcurrentMemoryPool::flushThreadCache(&caches->ways[i]);
+  }
+  if (t_caches == caches) {
+    t_caches = nullptr;
+  }
+  delete caches;
+}
+
+ThreadKey* threadKey() {
+  // Never deleted: threads may still exit after static destruction.
+  static ThreadKey* key = new ThreadKey(onThreadExit);
+  return key;
+}
+
+inline int sizeClassOf(size_t size) {
+  int size_class = 0;
+  size_t class_size = 16;
+  while (class_size < size) {
+    class_size <<= 1;
+    size_class++;
+  }
+  return size_class;
+}
+
+inline size_t classSize(int size_class) {
+  return (size_t) 16 << size_class;
+}
+
+} // namespace
+
+ConcurrentMemoryPool::ConcurrentMemoryPool()
+    : tag_(s_last_tag.fetch_add(1, std::memory_order_relaxed) + 1), epoch_(1), slabs_(nullptr), larges_(nullptr) {
+  for (int i = 0; i < kClassCount; i++) {
+    for (int j = 0; j < kDepotSlots; j++) {
+      depots_[i].slots[j].store(nullptr, std::memory_order_relaxed);
+    }
+    depots_[i].overflow = nullptr;
+  }
+  PoolRegistry* registry = poolRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  registry->pools[tag_] = this;
+}
+
+ConcurrentMemoryPool::~ConcurrentMemoryPool() {
+  {
+    PoolRegistry* registry = poolRegistry();
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    registry->pools.erase(tag_);
+  }
+  releaseAll();
+}
+
+ConcurrentMemoryPool::ThreadCache* ConcurrentMemoryPool::threadCache() {
+  uint64_t epoch = epoch_.load(std::memory_order_acquire);
+  ThreadCaches* caches = t_caches;
+  if (!caches) {
+    caches = new ThreadCaches();
+    // without the key the caches are leaked at thread exit
+    threadKey()->set(caches);
+    t_caches = caches;
+  }
+  ThreadCache* cache = nullptr;
+  for (int i = 0; i < kThreadCacheWays; i++) {
+    if (caches->ways[i].tag == tag_) {
+      cache = &caches->ways[i];
+      break;
+    }
+  }
+  if (!cache) {
+    cache = &caches->ways[caches->next_victim++ % kThreadCacheWays];
+    flushThreadCache(cache);
+    cache->tag = tag_;
+    cache->epoch = 0;
+  }
+  if (cache->epoch != epoch) {
+    memset(cache->heads, 0, sizeof(cache->heads));
+    memset(cache->counts, 0, sizeof(cache->counts));
+    cache->epoch = epoch;
+  }
+  return cache;
+}
+
+void ConcurrentMemoryPool::flushThreadCache(ThreadCache* cache) {
+  if (!cache->tag) {
+    return;
+  }
+  {
+    PoolRegistry* registry = poolRegistry();
+    std::lock_guard<std::mutex> registry_lock(registry->mutex);
+    auto it = registry->pools.find(cache->tag);
+    if (it != registry->pools.end()) {
+      ConcurrentMemoryPool* pool = it->second;
+      // excludes releaseAll(), blocks of an older epoch are already freed
+      std::lock_guard<std::mutex> lock(pool->mutex_);
+      if (cache->epoch == pool->epoch_.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < kClassCount; i++) {
+          if (cache->heads[i]) {
+            pool->pushDepot(i, cache->heads[i]);
+          }
+        }
+      }
+    }
+  }
+  cache->tag = 0;
+  cache->epoch = 0;
+  memset(cache->heads, 0, sizeof(cache->heads));
+  memset(cache->counts, 0, sizeof(cache->counts));
+}
+
+void ConcurrentMemoryPool::pushDepot(int size_class, FreeNode* batch) {
+  Depot& depot = depots_[size_class];
+  for (int i = 0; i < kDepotSlots; i++) {
+    FreeNode* expected = nullptr;
+    if (depot.slots[i].compare_exchange_strong(expected, batch, std::memory_order_release, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+  std::lock_guard<std::mutex> lock(depot.mutex);
+  batch->next_batch = depot.overflow;
+  depot.overflow = batch;
+}
+
+ConcurrentMemoryPool::FreeNode* ConcurrentMemoryPool::popDepot(int size_class) {
+  Depot& depot = depots_[size_class];
+  for (int i = 0; i < kDepotSlots; i++) {
+    if (depot.slots[i].load(std::memory_order_relaxed)) {
+      FreeNode* batch = depot.slots[i].exchange(nullptr, std::memory_order_acquire);
+      if (batch) {
+        return batch;
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(depot.mutex);
+  FreeNode* batch = depot.overflow;
+  if (batch) {
+    depot.overflow = batch->next_batch;
+  }
+  return batch;
+}
+
+ConcurrentMemoryPool::FreeNode* ConcurrentMemoryPool::refill(ThreadCache* cache, int size_class) {
+  FreeNode* list = popDepot(size_class);
+  uint32_t count = 0;
+
+  if (list) {
+    // at most 2 * kCacheLimit blocks
+    for (FreeNode* node = list; node; node = node->next) {
+      count++;
+    }
+  } else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t block_size = kHeaderSize + classSize(size_class);
+    Slab* slab = (Slab*) ::malloc(kSlabSize);
+    if (!slab) {
+      return nullptr;
+    }
+    slab->next = slabs_;
+    slabs_ = slab;
+
+    // the first kCacheLimit blocks go to the cache, the others to the depot in batches
+    char* begin = (char*) (slab + 1);
+    char* end = (char*) slab + kSlabSize;
+    FreeNode* batch = nullptr;
+    FreeNode* prev = nullptr;
+    uint32_t batch_count = 0;
+    for (char* block = begin; block + block_size <= end; block += block_size) {
+      BlockHeader* header = (BlockHeader*) block;
+      FreeNode* node = (FreeNode*) (block + kHeaderSize);
+      header->tag = tag_;
+      header->size_class = (uint32_t) size_class;
+      header->state.store(kStateFree, std::memory_order_relaxed);
+      node->next = nullptr;
+      if (prev) {
+        prev->next = node;
+      } else {
+        batch = node;
+      }
+      prev = node;
+      if (++batch_count == kCacheLimit) {
+        if (list) {
+          pushDepot(size_class, batch);
+        } else {
+          list = batch;
+          count = batch_count;
+        }
+        prev = nullptr;
+        batch_count = 0;
+      }
+    }
+    if (batch_count) {
+      if (list) {
+        pushDepot(size_class, batch);
+      } else {
+        list = batch;
+        count = batch_count;
+      }
+    }
+  }
+
+  cache->heads[size_class] = list;
+  cache->counts[size_class] = count;
+  return list;
+}
+
+void* ConcurrentMemoryPool::allocate(size_t size) {
+  if (size > kMaxClassSize) {
+    return allocateLarge(size);
+  }
+
+  int size_class = sizeClassOf(size);
+  ThreadCache* cache = threadCache();
+  FreeNode* node = cache->heads[size_class];
+  if (!node) {
+    node = refill(cache, size_class);
+    if (!node) {
+      return nullptr;
+    }
+  }
+  cache->heads[size_class] = node->next;
+  cache->counts[size_class]--;
+  headerOf(node)->state.store(kStateAllocated, std::memory_order_relaxed);
+  return node;
+}
+
+bool ConcurrentMemoryPool::release(void *ptr) {
+  if (!ptr) {
+    return false;
+  }
+
+  BlockHeader* header = headerOf(ptr);
+  if (header->tag != tag_) {
+    return false;
+  }
+  uint32_t expected = kStateAllocated;
+  if (!header->state.compare_exchange_strong(expected, kStateFree, std::memory_order_relaxed)) {
+    return false;
+  }
+  if (header->size_class == kLargeClass) {
+    return releaseLarge(ptr);
+  }
+
+  int size_class = (int) header->size_class;
+  ThreadCache* cache = threadCache();
+  FreeNode* node = (FreeNode*) ptr;
+  node->next = cache->heads[size_class];
+  cache->heads[size_class] = node;
+  if (++cache->counts[size_class] >= kCacheLimit * 2) {
+    // hand a full magazine over to the depot for the other threads
+    FreeNode* last = node;
+    for (uint32_t i = 1; i < kCacheLimit; i++) {
+      last = last->next;
+    }
+    cache->heads[size_class] = last->next;
+    cache->counts[size_class] -= kCacheLimit;
+    last->next = nullptr;
+    pushDepot(size_class, node);
+  }
+  return true;
+}
+
+void* ConcurrentMemoryPool::allocateLarge(size_t size) {
+  LargeHeader* large = (LargeHeader*) ::malloc(sizeof(LargeHeader) + size);
+  if (!large) {
+    return nullptr;
+  }
+  large->block.tag = tag_;
+  large->block.size_class = kLargeClass;
+  large->block.state.store(kStateAllocated, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  large->prev = nullptr;
+  large->next = larges_;
+  if (larges_) {
+    larges_->prev = large;
+  }
+  larges_ = large;
+  return large + 1;
+}
+
+bool ConcurrentMemoryPool::releaseLarge(void* ptr) {
+  LargeHeader* large = ((LargeHeader*) ptr) - 1;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (large->prev) {
+    large->prev->next = large->next;
+  } else {
+    larges_ = large->next;
+  }
+  if (large->next) {
+    large->next->prev = large->prev;
+  }
+  ::free(large);
+  return true;
+}
+
+void ConcurrentMemoryPool::releaseAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // invalidates every thread cache of this pool
+  epoch_.fetch_add(1, std::memory_order_acq_rel);
+
+  for (int i = 0; i < kClassCount; i++) {
+    for (int j = 0; j < kDepotSlots; j++) {
+      depots_[i].slots[j].store(nullptr, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> depot_lock(depots_[i].mutex);
+    depots_[i].overflow = nullptr;
+  }
+  while (slabs_) {
+    Slab* next = slabs_->next;
+    ::free(slabs_);
+    slabs_ = next;
+  }
+  while (larges_) {
+    LargeHeader* next = larges_->next;
+    ::free(larges_);
+    larges_ = next;
+  }
+}
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
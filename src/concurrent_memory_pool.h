@@ -0,0 +1,136 @@
+/**
+ * @file	concurrent_memory_pool.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/15
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_CONCURRENT_MEMORY_POOL_H_
+#define JCU_JVM_SRC_CONCURRENT_MEMORY_POOL_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+#include <jcu-jvm/memory_pool.h>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+/**
+ * Thread safe MemoryPool.
+ *
+ * Small requests are served from size classes (16 ~ 2048 bytes). Each thread
+ * keeps a small cache (magazine) of free blocks per class and exchanges
+ * batches of at most 2 * kCacheLimit blocks with a per class depot, so the
+ * common path takes no lock. The depot keeps kDepotSlots batches in slots
+ * filled by CAS from null and emptied by exchange, which has no ABA unlike a
+ * linked stack of batches; only batches beyond the slots go to a list under
+ * the class mutex. New slabs and large requests take a mutex.
+ *
+ * A thread cache evicted by another pool or left by an exiting thread is
+ * flushed back to the depots while the pool lives.
+ *
+ * release() takes null or a pointer returned by allocate() of any
+ * ConcurrentMemoryPool that releaseAll() has not reclaimed yet. It returns
+ * false for a double release or a block of another pool; any other pointer
+ * is not checked (the block header in front of it is read).
+ *
+ * releaseAll() and the destructor must not run concurrently with
+ * allocate()/release() on the same pool.
+ */
+class ConcurrentMemoryPool : public MemoryPool {
+ public:
+  static const int kClassCount = 8;
+  static const size_t kMaxClassSize = 2048;
+  static const size_t kHeaderSize = 16;
+  static const size_t kSlabSize = 64 * 1024;
+  static const uint32_t kCacheLimit = 64;
+  static const int kDepotSlots = 8;
+
+  struct FreeNode {
+    FreeNode* next;
+    /**
+     * next batch of the depot overflow, only valid on the first node of a batch
+     */
+    FreeNode* next_batch;
+  };
+
+  struct BlockHeader {
+    uint64_t tag;
+    uint32_t size_class;
+    std::atomic<uint32_t> state;
+  };
+
+  struct LargeHeader {
+    LargeHeader* prev;
+    LargeHeader* next;
+    BlockHeader block;
+  };
+
+  struct Slab {
+    Slab* next;
+    uint64_t reserved;
+  };
+
+  struct ThreadCache {
+    uint64_t tag;
+    uint64_t epoch;
+    FreeNode* heads[kClassCount];
+    uint32_t counts[kClassCount];
+  };
+
+  struct Depot {
+    std::atomic<FreeNode*> slots[kDepotSlots];
+    std::mutex mutex;
+    FreeNode* overflow;
+  };
+
+ private:
+  const uint64_t tag_;
+  std::atomic<uint64_t> epoch_;
+
+  Depot depots_[kClassCount];
+
+  std::mutex mutex_;
+  Slab* slabs_;
+  LargeHeader* larges_;
+
+  static BlockHeader* headerOf(void* ptr) {
+    return (BlockHeader*)((char*) ptr - kHeaderSize);
+  }
+
+  ThreadCache* threadCache();
+  void pushDepot(int size_class, FreeNode* batch);
+  FreeNode* popDepot(int size_class);
+  FreeNode* refill(ThreadCache* cache, int size_class);
+
+ public:
+  /**
+   * Give the blocks of cache back to the depots of its pool if it still
+   * lives, then detach cache from it
+   */
+  static void flushThreadCache(ThreadCache* cache);
+
+ private:
+  void* allocateLarge(size_t size);
+  bool releaseLarge(void* ptr);
+
+ public:
+  ConcurrentMemoryPool();
+  ~ConcurrentMemoryPool();
+
+  void* allocate(size_t size) override;
+  bool release(void *ptr) override;
+  void releaseAll() override;
+};
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif // JCU_JVM_SRC_CONCURRENT_MEMORY_POOL_H_
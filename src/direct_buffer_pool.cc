@@ -0,0 +1,241 @@
+/**
+ * @file	direct_buffer_pool.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/22
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include <jcu-jvm/direct_buffer_pool.h>
+#include <jcu-jvm/method.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+JCU_JVM_CLASS_KEY(JavaNioBuffer, "java/nio/Buffer");
+JCU_JVM_TYPED_METHOD_KEY(JavaNioBufferClear, JavaNioBuffer, "clear", Object<JavaNioBuffer>());
+} // namespace
+
+class DirectBufferPoolImpl : public DirectBufferPool {
+ private:
+  struct Entry : Buffer {
+    uint32_t index;
+    /**
+     * free list link, index + 1 of the next free entry (0 for none)
+     */
+    std::atomic<uint32_t> next;
+    std::atomic<bool> in_use;
+  };
+
+  struct Slab {
+    char* memory;
+    std::unique_ptr<Entry[]> entries;
+  };
+
+  Options options_;
+
+  /**
+   * free list head: ABA tag in the upper 32 bits, index + 1 in the lower 32 bits
+   */
+  std::atomic<uint64_t> free_head_;
+
+  std::unique_ptr<std::atomic<Slab*>[]> slabs_;
+  std::atomic<size_t> slab_count_;
+  std::mutex grow_mutex_;
+
+ public:
+  explicit DirectBufferPoolImpl(const Options& options)
+      : options_(options), free_head_(0), slab_count_(0) {
+    if (!options_.buffers_per_slab) {
+      options_.buffers_per_slab = 1;
+    }
+    slabs_.reset(new std::atomic<Slab*>[options_.max_slabs]);
+    for (size_t i = 0; i < options_.max_slabs; i++) {
+      slabs_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~DirectBufferPoolImpl() override {
+    // without an env the global references can only be leaked
+    freeSlabs();
+  }
+
+  Buffer* acquire(JNIEnv* env) override {
+    Entry* entry = pop();
+    if (!entry) {
+      entry = grow(env);
+      if (!entry) {
+        return nullptr;
+      }
+    }
+    entry->in_use.store(true, std::memory_order_relaxed);
+    if (options_.clear_on_acquire) {
+      jobject self = JavaNioBufferClear::call(env, entry->byte_buffer);
+      if (self) {
+        env->DeleteLocalRef(self);
+      }
+    }
+    return entry;
+  }
+
+  void release(Buffer* buffer) override {
+    if (!buffer) {
+      return;
+    }
+    Entry* entry = static_cast<Entry*>(buffer);
+    // ignore double release, java may hand back a buffer native already released
+    if (entry->in_use.exchange(false, std::memory_order_acq_rel)) {
+      push(entry);
+    }
+  }
+
+  bool release(JNIEnv* env, jobject byte_buffer) override {
+    char* address = (char*) env->GetDirectBufferAddress(byte_buffer);
+    if (!address) {
+      return false;
+    }
+    size_t slab_size = options_.buffer_size * options_.buffers_per_slab;
+    size_t count = slab_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+      Slab* slab = slabs_[i].load(std::memory_order_acquire);
+      if (address >= slab->memory && address < slab->memory + slab_size) {
+        release(&slab->entries[(address - slab->memory) / options_.buffer_size]);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t bufferSize() const override {
+    return options_.buffer_size;
+  }
+
+  void destroy(JNIEnv* env) override {
+    std::lock_guard<std::mutex> lock(grow_mutex_);
+    size_t count = slab_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+      Slab* slab = slabs_[i].load(std::memory_order_relaxed);
+      for (size_t j = 0; j < options_.buffers_per_slab; j++) {
+        if (slab->entries[j].byte_buffer) {
+          env->DeleteGlobalRef(slab->entries[j].byte_buffer);
+          slab->entries[j].byte_buffer = nullptr;
+        }
+      }
+    }
+    freeSlabs();
+  }
+
+ private:
+  Entry* entryAt(uint32_t index) const {
+    Slab* slab = slabs_[index / options_.buffers_per_slab].load(std::memory_order_acquire);
+    return &slab->entries[index % options_.buffers_per_slab];
+  }
+
+  Entry* pop() {
+    uint64_t head = free_head_.load(std::memory_order_acquire);
+    for (;;) {
+      uint32_t link = (uint32_t) head;
+      if (!link) {
+        return nullptr;
+      }
+      Entry* entry = entryAt(link - 1);
+      uint64_t next = ((head >> 32) + 1) << 32 | entry->next.load(std::memory_order_relaxed);
+      if (free_head_.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return entry;
+      }
+    }
+  }
+
+  void push(Entry* entry) {
+    uint64_t head = free_head_.load(std::memory_order_relaxed);
+    for (;;) {
+      entry->next.store((uint32_t) head, std::memory_order_relaxed);
+      uint64_t next = ((head >> 32) + 1) << 32 | (uint64_t) (entry->index + 1);
+      if (free_head_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  Entry* grow(JNIEnv* env) {
+    std::lock_guard<std::mutex> lock(grow_mutex_);
+
+    // another thread may have grown the pool meanwhile
+    Entry* entry = pop();
+    if (entry) {
+      return entry;
+    }
+
+    size_t slab_index = slab_count_.load(std::memory_order_relaxed);
+    if (slab_index >= options_.max_slabs) {
+      return nullptr;
+    }
+
+    std::unique_ptr<Slab> slab(new Slab());
+    slab->memory = (char*) malloc(options_.buffer_size * options_.buffers_per_slab);
+    if (!slab->memory) {
+      return nullptr;
+    }
+    slab->entries.reset(new Entry[options_.buffers_per_slab]);
+    for (size_t i = 0; i < options_.buffers_per_slab; i++) {
+      Entry* item = &slab->entries[i];
+      item->data = slab->memory + i * options_.buffer_size;
+      item->size = options_.buffer_size;
+      item->index = (uint32_t) (slab_index * options_.buffers_per_slab + i);
+      item->next.store(0, std::memory_order_relaxed);
+      item->in_use.store(false, std::memory_order_relaxed);
+      item->byte_buffer = nullptr;
+
+      jobject local_ref = env->NewDirectByteBuffer(item->data, (jlong) item->size);
+      if (local_ref) {
+        item->byte_buffer = env->NewGlobalRef(local_ref);
+        env->DeleteLocalRef(local_ref);
+      }
+      if (!item->byte_buffer) {
+        for (size_t j = 0; j < i; j++) {
+          env->DeleteGlobalRef(slab->entries[j].byte_buffer);
+        }
+        free(slab->memory);
+        return nullptr;
+      }
+    }
+
+    slabs_[slab_index].store(slab.release(), std::memory_order_release);
+    slab_count_.store(slab_index + 1, std::memory_order_release);
+
+    Slab* published = slabs_[slab_index].load(std::memory_order_relaxed);
+    for (size_t i = 1; i < options_.buffers_per_slab; i++) {
+      push(&published->entries[i]);
+    }
+    return &published->entries[0];
+  }
+
+  void freeSlabs() {
+    size_t count = slab_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+      Slab* slab = slabs_[i].exchange(nullptr, std::memory_order_acq_rel);
+      if (slab) {
+        free(slab->memory);
+        delete slab;
+      }
+    }
+    slab_count_.store(0, std::memory_order_release);
+    free_head_.store(0, std::memory_order_release);
+  }
+};
+
+DirectBufferPool* DirectBufferPool::create(const Options& options) {
+  return new DirectBufferPoolImpl(options);
+}
+
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,80 @@
+/**
+ * @file	event_ring.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/28
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+
+#include <jcu-jvm/event_ring.h>
+
+namespace jcu {
+namespace jvm {
+
+class EventRingImpl : public EventRing {
+ private:
+  VM* vm_;
+  void* allocation_;
+  jobject byte_buffer_;
+
+ public:
+  EventRingImpl(VM* vm, const Options& options)
+      : vm_(vm), allocation_(nullptr), byte_buffer_(nullptr) {
+    capacity_ = 64;
+    while (capacity_ < options.capacity) {
+      capacity_ <<= 1;
+    }
+    multi_producer_ = options.multi_producer;
+  }
+
+  ~EventRingImpl() override {
+    if (byte_buffer_) {
+      JNIEnv* env = vm_->env();
+      if (env) {
+        env->DeleteGlobalRef(byte_buffer_);
+      }
+      // otherwise the vm is gone or the thread is not attached, the reference can only be leaked
+    }
+    free(allocation_);
+  }
+
+  bool init() {
+    // head and tail must not share a cache line with anything else
+    allocation_ = calloc(1, kHeaderSize + capacity_ + 64);
+    if (!allocation_) {
+      return false;
+    }
+    memory_ = (uint8_t*) (((uintptr_t) allocation_ + 63) & ~(uintptr_t) 63);
+
+    ScopedEnv env(vm_);
+    if (!env) {
+      return false;
+    }
+    jobject local_ref = env->NewDirectByteBuffer(memory_, (jlong) (kHeaderSize + capacity_));
+    if (!local_ref) {
+      return false;
+    }
+    byte_buffer_ = env->NewGlobalRef(local_ref);
+    env->DeleteLocalRef(local_ref);
+    return byte_buffer_ != nullptr;
+  }
+
+  jobject byteBuffer() const override {
+    return byte_buffer_;
+  }
+};
+
+EventRing* EventRing::create(VM* vm, const Options& options) {
+  EventRingImpl* ring = new EventRingImpl(vm, options);
+  if (!ring->init()) {
+    delete ring;
+    return nullptr;
+  }
+  return ring;
+}
+
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,106 @@
+/**
+ * @file	foreign_function.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/30
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <string.h>
+
+#include <jcu-jvm/foreign_function.h>
+#include <jcu-jvm/id_registry.h>
+#include <jcu-jvm/java_exception.h>
+#include <jcu-jvm/string_transcoder.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+JCU_JVM_CLASS_KEY(ForeignBindingsClass, "net/jclab/jcu/jvm/ForeignBindings");
+JCU_JVM_STATIC_METHOD_KEY(ForeignBindingsAvailable, ForeignBindingsClass, "available", "()Z");
+JCU_JVM_STATIC_METHOD_KEY(ForeignBindingsRegisterDowncall, ForeignBindingsClass, "registerDowncall",
+                          "(Ljava/lang/Class;Ljava/lang/String;JLjava/lang/String;Z)V");
+JCU_JVM_STATIC_METHOD_KEY(ForeignBindingsUpcallAddress, ForeignBindingsClass, "upcallAddress",
+                          "(Ljava/lang/String;Ljava/lang/String;)J");
+
+bool publishDowncall(JNIEnv* env, jclass bindings, jmethodID method, jclass owner, const ForeignFunctions::Entry& entry) {
+  jstring name = StringTranscoder::newString(env, entry.name);
+  if (!name) {
+    return false;
+  }
+  jstring descriptor = StringTranscoder::newString(env, entry.descriptor);
+  if (!descriptor) {
+    env->DeleteLocalRef(name);
+    return false;
+  }
+  env->CallStaticVoidMethod(bindings, method, owner, name, (jlong) (intptr_t) entry.fn, descriptor,
+                            entry.critical ? JNI_TRUE : JNI_FALSE);
+  env->DeleteLocalRef(descriptor);
+  env->DeleteLocalRef(name);
+  return !env->ExceptionCheck();
+}
+} // namespace
+
+jint ForeignFunctions::install(VM* vm, JNIEnv* env, jclass owner) const {
+  NativeMethods methods;
+  for (auto it = entries_.cbegin(); it != entries_.cend(); it++) {
+    methods.bind(it->name.c_str(), it->descriptor.c_str(), it->jni_fn);
+  }
+  jint rc = vm->registerNatives(env, owner, methods);
+  if (rc != JNI_OK || !available(vm, env)) {
+    return rc;
+  }
+  jclass bindings = IdRegistry::getClass<ForeignBindingsClass>(env);
+  jmethodID method = IdRegistry::getMethod<ForeignBindingsRegisterDowncall>(env);
+  if (!method) {
+    return JNI_ERR;
+  }
+  for (auto it = entries_.cbegin(); it != entries_.cend(); it++) {
+    if (!publishDowncall(env, bindings, method, owner, *it)) {
+      return JNI_ERR;
+    }
+  }
+  return JNI_OK;
+}
+
+bool ForeignFunctions::available(VM* vm, JNIEnv* env) {
+  if (!vm->foreignLinkerSupported()) {
+    return false;
+  }
+  jmethodID method = IdRegistry::getMethod<ForeignBindingsAvailable>(env);
+  if (!method) {
+    // ForeignBindings is not on the classpath, JNI only
+    JavaExceptions::take(env);
+    return false;
+  }
+  jboolean result = env->CallStaticBooleanMethod(IdRegistry::getClass<ForeignBindingsClass>(env), method);
+  if (JavaExceptions::take(env)) {
+    return false;
+  }
+  return result == JNI_TRUE;
+}
+
+void* ForeignFunctions::upcallAddress(JNIEnv* env, const char* name, const char* descriptor) {
+  jmethodID method = IdRegistry::getMethod<ForeignBindingsUpcallAddress>(env);
+  if (!method) {
+    JavaExceptions::take(env);
+    return nullptr;
+  }
+  jstring jname = StringTranscoder::newString(env, name, strlen(name));
+  jstring jdescriptor = jname ? StringTranscoder::newString(env, descriptor, strlen(descriptor)) : nullptr;
+  jlong address = 0;
+  if (jdescriptor) {
+    address = env->CallStaticLongMethod(IdRegistry::getClass<ForeignBindingsClass>(env), method, jname, jdescriptor);
+  }
+  if (JavaExceptions::take(env)) {
+    address = 0;
+  }
+  if (jdescriptor) env->DeleteLocalRef(jdescriptor);
+  if (jname) env->DeleteLocalRef(jname);
+  return (void*) (intptr_t) address;
+}
+
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,220 @@
+/**
+ * @file	handle_table.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/28
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <jcu-jvm/handle_table.h>
+#include <jcu-jvm/id_registry.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+JCU_JVM_CLASS_KEY(JavaLangObject, "java/lang/Object");
+} // namespace
+
+class HandleTableImpl : public HandleTable {
+ private:
+  struct Chunk {
+    /**
+     * global reference of the Object[] holding the objects
+     */
+    jobjectArray array;
+    /**
+     * odd while the slot holds an object
+     */
+    std::unique_ptr<std::atomic<uint32_t>[]> generations;
+  };
+
+  Options options_;
+  std::unique_ptr<std::atomic<Chunk*>[]> chunks_;
+  std::atomic<uint32_t> chunk_count_;
+
+  std::mutex mutex_;
+  std::vector<uint32_t> free_slots_;
+  std::atomic<size_t> size_;
+  /**
+   * first (even) generation of new slots, above every generation handed out before clear()
+   */
+  uint32_t generation_base_;
+
+ public:
+  explicit HandleTableImpl(const Options& options)
+      : options_(options), chunk_count_(0), size_(0), generation_base_(0) {
+    if (!options_.chunk_size) {
+      options_.chunk_size = 1;
+    }
+    chunks_.reset(new std::atomic<Chunk*>[options_.max_chunks]);
+    for (uint32_t i = 0; i < options_.max_chunks; i++) {
+      chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~HandleTableImpl() override {
+    // without an env the chunk references can only be leaked
+    freeChunks(nullptr);
+  }
+
+  Handle add(JNIEnv* env, jobject obj) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_slots_.empty() && !grow(env)) {
+      return 0;
+    }
+    uint32_t index = free_slots_.back();
+    Chunk* chunk = chunkOf(index);
+    uint32_t slot = index % options_.chunk_size;
+
+    env->SetObjectArrayElement(chunk->array, (jsize) slot, obj);
+    if (env->ExceptionCheck()) {
+      return 0;
+    }
+    free_slots_.pop_back();
+    // publish after the element is stored, get() checks the generation around its read
+    uint32_t generation = chunk->generations[slot].load(std::memory_order_relaxed) + 1;
+    chunk->generations[slot].store(generation, std::memory_order_release);
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return ((Handle) generation << 32) | (Handle) (index + 1);
+  }
+
+  jobject get(JNIEnv* env, Handle handle) const override {
+    uint32_t generation;
+    Chunk* chunk;
+    uint32_t slot;
+    if (!resolve(handle, &generation, &chunk, &slot)) {
+      return nullptr;
+    }
+    if (chunk->generations[slot].load(std::memory_order_acquire) != generation) {
+      return nullptr;
+    }
+    jobject obj = env->GetObjectArrayElement(chunk->array, (jsize) slot);
+    // removed (and maybe reused) while reading
+    if (chunk->generations[slot].load(std::memory_order_acquire) != generation) {
+      if (obj) {
+        env->DeleteLocalRef(obj);
+      }
+      return nullptr;
+    }
+    return obj;
+  }
+
+  bool remove(JNIEnv* env, Handle handle) override {
+    uint32_t generation;
+    Chunk* chunk;
+    uint32_t slot;
+    if (!resolve(handle, &generation, &chunk, &slot)) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (chunk->generations[slot].load(std::memory_order_relaxed) != generation) {
+      return false;
+    }
+    chunk->generations[slot].store(generation + 1, std::memory_order_release);
+    env->SetObjectArrayElement(chunk->array, (jsize) slot, nullptr);
+    free_slots_.push_back((uint32_t) (handle & 0xffffffff) - 1);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t size() const override {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  void clear(JNIEnv* env) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    freeChunks(env);
+  }
+
+ private:
+  Chunk* chunkOf(uint32_t index) const {
+    return chunks_[index / options_.chunk_size].load(std::memory_order_acquire);
+  }
+
+  bool resolve(Handle handle, uint32_t* generation, Chunk** chunk, uint32_t* slot) const {
+    uint32_t link = (uint32_t) (handle & 0xffffffff);
+    *generation = (uint32_t) (handle >> 32);
+    if (!link || !(*generation & 1)) {
+      return false;
+    }
+    uint32_t index = link - 1;
+    if (index / options_.chunk_size >= chunk_count_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *chunk = chunkOf(index);
+    *slot = index % options_.chunk_size;
+    return *chunk != nullptr;
+  }
+
+  bool grow(JNIEnv* env) {
+    uint32_t chunk_index = chunk_count_.load(std::memory_order_relaxed);
+    if (chunk_index >= options_.max_chunks
+        || (uint64_t) (chunk_index + 1) * options_.chunk_size >= 0xffffffffULL) {
+      return false;
+    }
+    jclass object_class = IdRegistry::getClass<JavaLangObject>(env);
+    if (!object_class) {
+      return false;
+    }
+    jobjectArray local_ref = env->NewObjectArray((jsize) options_.chunk_size, object_class, nullptr);
+    if (!local_ref) {
+      return false;
+    }
+    std::unique_ptr<Chunk> chunk(new Chunk());
+    chunk->array = (jobjectArray) env->NewGlobalRef(local_ref);
+    env->DeleteLocalRef(local_ref);
+    if (!chunk->array) {
+      return false;
+    }
+    chunk->generations.reset(new std::atomic<uint32_t>[options_.chunk_size]);
+    for (uint32_t i = 0; i < options_.chunk_size; i++) {
+      chunk->generations[i].store(generation_base_, std::memory_order_relaxed);
+    }
+
+    chunks_[chunk_index].store(chunk.release(), std::memory_order_release);
+    chunk_count_.store(chunk_index + 1, std::memory_order_release);
+
+    // lowest index on top
+    for (uint32_t i = options_.chunk_size; i > 0; i--) {
+      free_slots_.push_back(chunk_index * options_.chunk_size + i - 1);
+    }
+    return true;
+  }
+
+  void freeChunks(JNIEnv* env) {
+    uint32_t count = chunk_count_.load(std::memory_order_acquire);
+    chunk_count_.store(0, std::memory_order_release);
+    for (uint32_t i = 0; i < count; i++) {
+      Chunk* chunk = chunks_[i].exchange(nullptr, std::memory_order_acq_rel);
+      if (!chunk) {
+        continue;
+      }
+      for (uint32_t j = 0; j < options_.chunk_size; j++) {
+        uint32_t generation = chunk->generations[j].load(std::memory_order_relaxed);
+        if (generation >= generation_base_) {
+          generation_base_ = (generation + 2) & ~1u;
+        }
+      }
+      if (env) {
+        env->DeleteGlobalRef(chunk->array);
+      }
+      delete chunk;
+    }
+    free_slots_.clear();
+    size_.store(0, std::memory_order_relaxed);
+  }
+};
+
+HandleTable* HandleTable::create(const Options& options) {
+  return new HandleTableImpl(options);
+}
+
+} // namespace jvm
+} // namespace jcu
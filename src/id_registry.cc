@@ -0,0 +1,96 @@
+/**
+ * @file	id_registry.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/11
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <mutex>
+#include <vector>
+
+#include <jcu-jvm/id_registry.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+
+struct ResolvedSlot {
+  std::atomic<void*>* slot;
+  IdRegistry::Kind kind;
+};
+
+std::mutex& registryMutex() {
+  static std::mutex* mutex = new std::mutex();
+  return *mutex;
+}
+
+std::vector<ResolvedSlot>& resolvedSlots() {
+  static std::vector<ResolvedSlot>* slots = new std::vector<ResolvedSlot>();
+  return *slots;
+}
+
+} // namespace
+
+void* IdRegistry::resolveClass(JNIEnv* env, std::atomic<void*>* slot, const char* name) {
+  // FindClass may run static initializers which call back into the registry, so it is done without the lock.
+  jclass local_ref = env->FindClass(name);
+  if (!local_ref) {
+    return nullptr;
+  }
+  void* value = env->NewGlobalRef(local_ref);
+  env->DeleteLocalRef(local_ref);
+  if (!value) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(registryMutex());
+  void* expected = nullptr;
+  if (!slot->compare_exchange_strong(expected, value, std::memory_order_acq_rel)) {
+    // resolved by another thread
+    env->DeleteGlobalRef((jobject) value);
+    return expected;
+  }
+  resolvedSlots().push_back({slot, kClass});
+  return value;
+}
+
+void* IdRegistry::resolveMember(JNIEnv* env, std::atomic<void*>* slot, Kind kind, jclass clazz, const char* name, const char* signature) {
+  void* value;
+
+  switch (kind) {
+    case kMethod: value = env->GetMethodID(clazz, name, signature); break;
+    case kStaticMethod: value = env->GetStaticMethodID(clazz, name, signature); break;
+    case kField: value = env->GetFieldID(clazz, name, signature); break;
+    case kStaticField: value = env->GetStaticFieldID(clazz, name, signature); break;
+    default: value = nullptr; break;
+  }
+  if (!value) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(registryMutex());
+  void* expected = nullptr;
+  if (!slot->compare_exchange_strong(expected, value, std::memory_order_acq_rel)) {
+    return expected;
+  }
+  resolvedSlots().push_back({slot, kind});
+  return value;
+}
+
+void IdRegistry::reset(JNIEnv* env) {
+  std::lock_guard<std::mutex> lock(registryMutex());
+  std::vector<ResolvedSlot>& slots = resolvedSlots();
+  for (auto it = slots.begin(); it != slots.end(); it++) {
+    void* value = it->slot->exchange(nullptr, std::memory_order_acq_rel);
+    if (env && value && it->kind == kClass) {
+      env->DeleteGlobalRef((jobject) value);
+    }
+  }
+  slots.clear();
+}
+
+} // namespace jvm
+} // namespace jcu
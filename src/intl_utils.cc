@@ -7,10 +7,10 @@
  *            of the Apache License 2.0.  See the LICENSE file for details.
  */
 
-#include <codecvt>
-#include <locale>
-
 #include <string.h>
+#include <wchar.h>
+
+#include <jcu-jvm/string_transcoder.h>
 
 #include "intl_utils.h"
 
@@ -21,27 +21,25 @@ namespace jvm {
 namespace intl {
 
 #ifdef _UNICODE
+static_assert(sizeof(wchar_t) == sizeof(jchar), "wchar_t must be UTF-16");
+
 std::basic_string<system_char_t> utf8ToSystem(const char* text, int length) {
-  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>,wchar_t> s_utf8_to_wstr_convert;
   if (!text) {
     return std::basic_string<system_char_t>();
   }
-  if (length < 0) {
-    return s_utf8_to_wstr_convert.from_bytes(text);
-  } else {
-    return s_utf8_to_wstr_convert.from_bytes(text, text + length);
-  }
+  size_t src_length = (length < 0) ? strlen(text) : (size_t) length;
+  std::basic_string<system_char_t> result(src_length, 0);
+  result.resize(StringTranscoder::utf8ToUtf16(text, src_length, (jchar*) &result[0]));
+  return result;
 }
 std::string systemToUtf8(const system_char_t* text, int length) {
-  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>,wchar_t> s_utf8_to_wstr_convert;
   if (!text) {
     return std::string();
   }
-  if (length < 0) {
-    return s_utf8_to_wstr_convert.to_bytes(text);
-  } else {
-    return s_utf8_to_wstr_convert.to_bytes(text, text + length);
-  }
+  size_t src_length = (length < 0) ? wcslen(text) : (size_t) length;
+  std::string result(src_length * 3, 0);
+  result.resize(StringTranscoder::utf16ToUtf8((const jchar*) text, src_length, &result[0]));
+  return result;
 }
 #else
 std::basic_string<system_char_t> utf8ToSystem(const char* text, int length) {
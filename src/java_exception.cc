@@ -0,0 +1,145 @@
+/**
+ * @file	java_exception.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/27
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <jcu-jvm/java_exception.h>
+#include <jcu-jvm/id_registry.h>
+#include <jcu-jvm/string_transcoder.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+JCU_JVM_CLASS_KEY(JavaLangClass, "java/lang/Class");
+JCU_JVM_METHOD_KEY(JavaLangClassGetName, JavaLangClass, "getName", "()Ljava/lang/String;");
+JCU_JVM_CLASS_KEY(JavaLangThrowable, "java/lang/Throwable");
+JCU_JVM_METHOD_KEY(JavaLangThrowableGetMessage, JavaLangThrowable, "getMessage", "()Ljava/lang/String;");
+JCU_JVM_METHOD_KEY(JavaLangThrowablePrintStackTrace, JavaLangThrowable, "printStackTrace", "(Ljava/io/PrintWriter;)V");
+JCU_JVM_CLASS_KEY(JavaIoStringWriter, "java/io/StringWriter");
+JCU_JVM_METHOD_KEY(JavaIoStringWriterInit, JavaIoStringWriter, "<init>", "()V");
+JCU_JVM_METHOD_KEY(JavaIoStringWriterToString, JavaIoStringWriter, "toString", "()Ljava/lang/String;");
+JCU_JVM_CLASS_KEY(JavaIoPrintWriter, "java/io/PrintWriter");
+JCU_JVM_METHOD_KEY(JavaIoPrintWriterInit, JavaIoPrintWriter, "<init>", "(Ljava/io/Writer;)V");
+JCU_JVM_METHOD_KEY(JavaIoPrintWriterFlush, JavaIoPrintWriter, "flush", "()V");
+
+/**
+ * Take the string result of a call, clearing the exception the call raised
+ */
+bool takeString(JNIEnv* env, jobject str, std::string* out) {
+  if (env->ExceptionCheck()) {
+    env->ExceptionClear();
+    return false;
+  }
+  if (!str) {
+    return false;
+  }
+  bool ok = StringTranscoder::getString(env, (jstring) str, out);
+  env->DeleteLocalRef(str);
+  if (!ok) {
+    env->ExceptionClear();
+  }
+  return ok;
+}
+
+/**
+ * @return null with the exception cleared if the id can not be resolved
+ */
+template <class MethodKey>
+jmethodID methodOf(JNIEnv* env) {
+  jmethodID method = IdRegistry::getMethod<MethodKey>(env);
+  if (!method) {
+    env->ExceptionClear();
+  }
+  return method;
+}
+
+void describeStack(JNIEnv* env, jthrowable throwable, std::string* out) {
+  jmethodID writer_init = methodOf<JavaIoStringWriterInit>(env);
+  jmethodID writer_to_string = methodOf<JavaIoStringWriterToString>(env);
+  jmethodID printer_init = methodOf<JavaIoPrintWriterInit>(env);
+  jmethodID printer_flush = methodOf<JavaIoPrintWriterFlush>(env);
+  jmethodID print_stack_trace = methodOf<JavaLangThrowablePrintStackTrace>(env);
+  if (!writer_init || !writer_to_string || !printer_init || !printer_flush || !print_stack_trace) {
+    return;
+  }
+
+  jobject writer = env->NewObject(IdRegistry::getClass<JavaIoStringWriter>(env), writer_init);
+  if (!writer) {
+    env->ExceptionClear();
+    return;
+  }
+  jobject printer = env->NewObject(IdRegistry::getClass<JavaIoPrintWriter>(env), printer_init, writer);
+  if (printer) {
+    env->CallVoidMethod(throwable, print_stack_trace, printer);
+    if (!env->ExceptionCheck()) {
+      env->CallVoidMethod(printer, printer_flush);
+    }
+    if (!env->ExceptionCheck()) {
+      takeString(env, env->CallObjectMethod(writer, writer_to_string), out);
+    }
+    env->ExceptionClear();
+    env->DeleteLocalRef(printer);
+  } else {
+    env->ExceptionClear();
+  }
+  env->DeleteLocalRef(writer);
+}
+
+} // namespace
+
+std::string JavaError::toString() const {
+  if (message.empty()) {
+    return class_name;
+  }
+  return class_name + ": " + message;
+}
+
+bool JavaExceptions::take(JNIEnv* env, JavaError* error, Detail detail) {
+  if (!env->ExceptionCheck()) {
+    return false;
+  }
+  if (!error || detail == kDetailNone) {
+    env->ExceptionClear();
+    return true;
+  }
+  jthrowable throwable = env->ExceptionOccurred();
+  env->ExceptionClear();
+  if (throwable) {
+    describe(env, throwable, error, detail);
+    env->DeleteLocalRef(throwable);
+  }
+  return true;
+}
+
+void JavaExceptions::describe(JNIEnv* env, jthrowable throwable, JavaError* error, Detail detail) {
+  error->class_name.clear();
+  error->message.clear();
+  error->stack_trace.clear();
+  if (detail == kDetailNone) {
+    return;
+  }
+
+  jmethodID get_name = methodOf<JavaLangClassGetName>(env);
+  if (get_name) {
+    jclass clazz = env->GetObjectClass(throwable);
+    takeString(env, env->CallObjectMethod(clazz, get_name), &error->class_name);
+    env->DeleteLocalRef(clazz);
+  }
+
+  jmethodID get_message = methodOf<JavaLangThrowableGetMessage>(env);
+  if (get_message) {
+    takeString(env, env->CallObjectMethod(throwable, get_message), &error->message);
+  }
+
+  if (detail == kDetailStack) {
+    describeStack(env, throwable, &error->stack_trace);
+  }
+}
+
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,163 @@
+/**
+ * @file	java_future.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/29
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <atomic>
+#include <mutex>
+
+#include <jcu-jvm/java_future.h>
+#include <jcu-jvm/id_registry.h>
+#include <jcu-jvm/java_exception.h>
+
+#include "java_future_intl.h"
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+JCU_JVM_CLASS_KEY(NativeCompletionClass, "net/jclab/jcu/jvm/NativeCompletion");
+JCU_JVM_METHOD_KEY(NativeCompletionInit, NativeCompletionClass, "<init>", "(J)V");
+JCU_JVM_CLASS_KEY(CompletionStageClass, "java/util/concurrent/CompletionStage");
+JCU_JVM_METHOD_KEY(CompletionStageWhenComplete, CompletionStageClass, "whenComplete",
+                   "(Ljava/util/function/BiConsumer;)Ljava/util/concurrent/CompletionStage;");
+
+/**
+ * Shared by whenComplete() and the java consumer, the last release() deletes it.
+ * Whoever sets consumed first decides whether the callback runs.
+ */
+struct Completion {
+  VM* vm;
+  JavaFutures::Executor executor;
+  JavaFutures::Callback callback;
+  std::atomic<bool> consumed;
+  std::atomic<int> refs;
+
+  Completion(VM* vm, JavaFutures::Executor executor, JavaFutures::Callback callback)
+      : vm(vm), executor(std::move(executor)), callback(std::move(callback)), consumed(false), refs(2) {}
+
+  void release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+};
+
+void JNICALL nativeComplete(JNIEnv* env, jclass, jlong handle, jobject value, jthrowable error) {
+  Completion* completion = (Completion*) (intptr_t) handle;
+  if (!completion) {
+    return;
+  }
+  if (completion->consumed.exchange(true, std::memory_order_acq_rel)) {
+    // whenComplete() already failed
+    completion->release();
+    return;
+  }
+  FutureOutcome outcome(completion->vm, env, value, error);
+  JavaFutures::Executor executor = std::move(completion->executor);
+  JavaFutures::Callback callback = std::move(completion->callback);
+  completion->release();
+  if (!executor) {
+    callback(std::move(outcome));
+    return;
+  }
+  executor([callback, outcome]() {
+    callback(outcome);
+  });
+}
+
+/**
+ * vm whose java vm has the natives registered, cleared when it is destroyed
+ * so that a new java vm (even at the same VM address) registers them again
+ */
+std::mutex s_registration_mutex;
+VM* s_registered_vm = nullptr;
+
+bool registerNativeCompletion(VM* vm, JNIEnv* env) {
+  std::lock_guard<std::mutex> lock(s_registration_mutex);
+  if (s_registered_vm == vm) {
+    return true;
+  }
+  jclass clazz = IdRegistry::getClass<NativeCompletionClass>(env);
+  if (!clazz) {
+    return false;
+  }
+  NativeMethods methods;
+  methods.bind("complete", "(JLjava/lang/Object;Ljava/lang/Throwable;)V", (void*) &nativeComplete);
+  if (vm->registerNatives(env, clazz, methods) != JNI_OK) {
+    return false;
+  }
+  s_registered_vm = vm;
+  return true;
+}
+} // namespace
+
+namespace intl {
+void forgetNativeCompletion(VM* vm) {
+  std::lock_guard<std::mutex> lock(s_registration_mutex);
+  if (s_registered_vm == vm) {
+    s_registered_vm = nullptr;
+  }
+}
+} // namespace intl
+
+FutureOutcome::Refs::~Refs() {
+  if (!value && !error) {
+    return;
+  }
+  JNIEnv* env = vm->env();
+  if (env) {
+    if (value) env->DeleteGlobalRef(value);
+    if (error) env->DeleteGlobalRef(error);
+  }
+  // otherwise the thread is not attached (or the vm is gone), the references can only be leaked
+}
+
+FutureOutcome::FutureOutcome(VM* vm, JNIEnv* env, jobject value, jthrowable error)
+    : refs_(std::make_shared<Refs>()) {
+  refs_->vm = vm;
+  refs_->value = value ? env->NewGlobalRef(value) : nullptr;
+  refs_->error = error ? (jthrowable) env->NewGlobalRef(error) : nullptr;
+}
+
+bool JavaFutures::whenComplete(VM* vm, JNIEnv* env, jobject stage, Executor executor, Callback callback) {
+  if (!registerNativeCompletion(vm, env)) {
+    return false;
+  }
+  jmethodID init = IdRegistry::getMethod<NativeCompletionInit>(env);
+  jmethodID when_complete = IdRegistry::getMethod<CompletionStageWhenComplete>(env);
+  if (!init || !when_complete) {
+    return false;
+  }
+
+  Completion* completion = new Completion(vm, std::move(executor), std::move(callback));
+  jobject consumer = env->NewObject(IdRegistry::getClass<NativeCompletionClass>(env), init, (jlong) (intptr_t) completion);
+  if (!consumer) {
+    delete completion;
+    return false;
+  }
+  // the consumer may run (even synchronously) from here on
+  jobject dependent = env->CallObjectMethod(stage, when_complete, consumer);
+  env->DeleteLocalRef(consumer);
+  bool attached = true;
+  if (env->ExceptionCheck()) {
+    // The consumer may already have run, e.g. on a completed stage that propagates the
+    // exception of its action. Then the callback is delivered and the exception dropped,
+    // otherwise it never runs the callback (its reference leaks if it never runs at all).
+    attached = completion->consumed.exchange(true, std::memory_order_acq_rel);
+    if (attached) {
+      JavaExceptions::take(env);
+    }
+  } else {
+    env->DeleteLocalRef(dependent);
+  }
+  completion->release();
+  return attached;
+}
+
+} // namespace jvm
+} // namespace jcu
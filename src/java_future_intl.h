@@ -0,0 +1,29 @@
+/**
+ * @file	java_future_intl.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/29
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_JAVA_FUTURE_INTL_H_
+#define JCU_JVM_SRC_JAVA_FUTURE_INTL_H_
+
+#include <jcu-jvm/vm.h>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+/**
+ * Forget that the NativeCompletion natives are registered for vm,
+ * called when its java vm is destroyed
+ */
+void forgetNativeCompletion(VM* vm);
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif // JCU_JVM_SRC_JAVA_FUTURE_INTL_H_
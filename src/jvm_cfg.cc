@@ -0,0 +1,123 @@
+/**
+ * @file	jvm_cfg.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/17
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "jvm_cfg.h"
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+bool JvmCfg::load(const char* path) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::stringstream content;
+  content << file.rdbuf();
+  parse(content.str());
+  return true;
+}
+
+void JvmCfg::parse(const std::string& content) {
+  std::istringstream input(content);
+  std::string line;
+
+  entries_.clear();
+  while (std::getline(input, line)) {
+    std::istringstream tokens(line);
+    std::string name;
+    std::string flag;
+    Entry entry;
+
+    if (!(tokens >> name) || name[0] == '#' || name[0] != '-' || name.length() < 2) {
+      continue;
+    }
+    entry.name = name.substr(1);
+    entry.flag = kKnown;
+    if (tokens >> flag) {
+      if (flag == "ALIASED_TO") {
+        std::string alias;
+        entry.flag = kAliasedTo;
+        if (!(tokens >> alias) || alias.length() < 2 || alias[0] != '-') {
+          continue;
+        }
+        entry.alias = alias.substr(1);
+      } else if (flag == "IGNORE") {
+        entry.flag = kIgnore;
+      } else if (flag == "ERROR") {
+        entry.flag = kError;
+      }
+      // KNOWN, WARN, IF_SERVER_CLASS: usable
+    }
+    entries_.emplace_back(std::move(entry));
+  }
+}
+
+const JvmCfg::Entry* JvmCfg::find(const std::string& name) const {
+  for (auto it = entries_.cbegin(); it != entries_.cend(); it++) {
+    if (it->name == name) {
+      return &*it;
+    }
+  }
+  return nullptr;
+}
+
+std::string JvmCfg::resolve(const std::string& name) const {
+  std::string current(name);
+  // bounded, jvm.cfg may contain alias loops
+  for (size_t depth = 0; depth <= entries_.size(); depth++) {
+    const Entry* entry = find(current);
+    if (!entry) {
+      return "";
+    }
+    switch (entry->flag) {
+      case kKnown: return current;
+      case kAliasedTo: current = entry->alias; break;
+      default: return "";
+    }
+  }
+  return "";
+}
+
+std::string JvmCfg::preferredName(VmSelection selection, const std::string& explicit_name) {
+  switch (selection) {
+    case kVmSelectClient: return "client";
+    case kVmSelectMinimal: return "minimal";
+    case kVmSelectExplicit: return explicit_name;
+    case kVmSelectServer:
+    default: return "server";
+  }
+}
+
+std::vector<std::string> JvmCfg::candidates(VmSelection selection, const std::string& explicit_name) const {
+  std::vector<std::string> result;
+  std::string preferred = resolve(preferredName(selection, explicit_name));
+
+  if (!preferred.empty()) {
+    result.push_back(preferred);
+  }
+  if (selection == kVmSelectExplicit) {
+    return result;
+  }
+  for (auto it = entries_.cbegin(); it != entries_.cend(); it++) {
+    std::string name = resolve(it->name);
+    if (!name.empty() && std::find(result.cbegin(), result.cend(), name) == result.cend()) {
+      result.push_back(name);
+    }
+  }
+  return result;
+}
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
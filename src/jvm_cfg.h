@@ -0,0 +1,74 @@
+/**
+ * @file	jvm_cfg.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/17
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_JVM_CFG_H_
+#define JCU_JVM_SRC_JVM_CFG_H_
+
+#include <string>
+#include <vector>
+
+#include <jcu-jvm/os_handler.h>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+/**
+ * Parser of $JAVA_HOME/lib/jvm.cfg
+ *
+ * -server KNOWN
+ * -client IGNORE
+ * -hotspot ALIASED_TO -client
+ */
+class JvmCfg {
+ public:
+  enum Flag {
+    kKnown = 0,
+    kAliasedTo,
+    kIgnore,
+    kError,
+  };
+
+  struct Entry {
+    std::string name;
+    Flag flag;
+    std::string alias;
+  };
+
+ private:
+  std::vector<Entry> entries_;
+
+  const Entry* find(const std::string& name) const;
+  std::string resolve(const std::string& name) const;
+
+ public:
+  bool load(const char* path);
+  void parse(const std::string& content);
+
+  const std::vector<Entry>& entries() const {
+    return entries_;
+  }
+
+  /**
+   * Usable vm names (aliases resolved) in order of preference:
+   * the vm preferred by the selection first, then the jvm.cfg order.
+   */
+  std::vector<std::string> candidates(VmSelection selection, const std::string& explicit_name) const;
+
+  /**
+   * vm name preferred by the selection ("server", "client", ...)
+   */
+  static std::string preferredName(VmSelection selection, const std::string& explicit_name);
+};
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif // JCU_JVM_SRC_JVM_CFG_H_
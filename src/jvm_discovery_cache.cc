@@ -0,0 +1,102 @@
+/**
+ * @file	jvm_discovery_cache.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/16
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+
+#include <fstream>
+#include <vector>
+
+#include "jvm_discovery_cache.h"
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+static bool parseLine(const std::string& line, JvmDiscoveryCacheEntry* entry) {
+  std::string* fields[] = {&entry->key, &entry->jvm_path, &entry->jsig_path, &entry->vm_name, &entry->fingerprint};
+  const int count = sizeof(fields) / sizeof(fields[0]);
+  size_t begin = 0;
+  for (int i = 0; i < count; i++) {
+    size_t end = line.find('\t', begin);
+    if (i == count - 1) {
+      if (end != std::string::npos) return false;
+      end = line.length();
+    } else if (end == std::string::npos) {
+      return false;
+    }
+    fields[i]->assign(line, begin, end - begin);
+    begin = end + 1;
+  }
+  return true;
+}
+
+static bool isStorable(const std::string& value) {
+  return value.find_first_of("\t\r\n") == std::string::npos;
+}
+
+bool JvmDiscoveryCache::lookup(const std::string& key, JvmDiscoveryCacheEntry* entry) const {
+  std::ifstream file(path_.c_str());
+  std::string line;
+  while (std::getline(file, line)) {
+    JvmDiscoveryCacheEntry item;
+    if (parseLine(line, &item) && item.key == key) {
+      *entry = std::move(item);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool JvmDiscoveryCache::store(const JvmDiscoveryCacheEntry& entry, const std::string& temp_suffix) const {
+  if (!isStorable(entry.key) || !isStorable(entry.jvm_path) || !isStorable(entry.jsig_path)
+      || !isStorable(entry.vm_name) || !isStorable(entry.fingerprint)) {
+    return false;
+  }
+
+  std::vector<std::string> lines;
+  {
+    std::ifstream file(path_.c_str());
+    std::string line;
+    while (std::getline(file, line)) {
+      JvmDiscoveryCacheEntry item;
+      if (parseLine(line, &item) && item.key != entry.key) {
+        lines.emplace_back(std::move(line));
+      }
+    }
+  }
+  lines.emplace_back(entry.key + "\t" + entry.jvm_path + "\t" + entry.jsig_path + "\t" + entry.vm_name + "\t" + entry.fingerprint);
+
+  std::string temp_path(path_ + ".tmp." + temp_suffix);
+  {
+    std::ofstream file(temp_path.c_str(), std::ios::out | std::ios::trunc);
+    for (auto it = lines.cbegin(); it != lines.cend(); it++) {
+      file << *it << '\n';
+    }
+    file.flush();
+    if (!file) {
+      file.close();
+      ::remove(temp_path.c_str());
+      return false;
+    }
+  }
+
+  if (::rename(temp_path.c_str(), path_.c_str()) != 0) {
+    // windows does not replace an existing file
+    ::remove(path_.c_str());
+    if (::rename(temp_path.c_str(), path_.c_str()) != 0) {
+      ::remove(temp_path.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
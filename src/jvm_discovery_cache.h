@@ -0,0 +1,59 @@
+/**
+ * @file	jvm_discovery_cache.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/16
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_JVM_DISCOVERY_CACHE_H_
+#define JCU_JVM_SRC_JVM_DISCOVERY_CACHE_H_
+
+#include <string>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+struct JvmDiscoveryCacheEntry {
+  /**
+   * JAVA_HOME, plus the vm selection if it is not the default
+   */
+  std::string key;
+  std::string jvm_path;
+  std::string jsig_path;
+  std::string vm_name;
+  /**
+   * platform specific identity of jvm_path (inode, mtime, size...)
+   */
+  std::string fingerprint;
+};
+
+/**
+ * On-disk cache of resolved jvm library paths keyed by JAVA_HOME.
+ *
+ * Text file, one tab separated entry per line:
+ * key, jvm_path, jsig_path, vm_name, fingerprint
+ */
+class JvmDiscoveryCache {
+ private:
+  std::string path_;
+
+ public:
+  explicit JvmDiscoveryCache(const std::string& path) : path_(path) {}
+
+  bool lookup(const std::string& key, JvmDiscoveryCacheEntry* entry) const;
+
+  /**
+   * Replace the entry of entry.key (write to temp file and rename)
+   * @param temp_suffix unique per process, e.g. the pid
+   */
+  bool store(const JvmDiscoveryCacheEntry& entry, const std::string& temp_suffix) const;
+};
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif // JCU_JVM_SRC_JVM_DISCOVERY_CACHE_H_
@@ -1,8 +1,16 @@
 #include <jcu-jvm/jvm_library.h>
 #include <jcu-jvm/vm.h>
+#include <jcu-jvm/method.h>
+#include <jcu-jvm/string_transcoder.h>
 
 #include <thread>
 
+JCU_JVM_CLASS_KEY(DaemonLoader, "org/apache/commons/daemon/support/DaemonLoader");
+JCU_JVM_TYPED_STATIC_METHOD_KEY(DaemonLoaderLoad, DaemonLoader, "load", jboolean(jstring, jcu::jvm::Array<jstring>));
+JCU_JVM_TYPED_STATIC_METHOD_KEY(DaemonLoaderStart, DaemonLoader, "start", jboolean());
+JCU_JVM_TYPED_STATIC_METHOD_KEY(DaemonLoaderStop, DaemonLoader, "stop", jboolean());
+JCU_JVM_CLASS_KEY(JavaLangString, "java/lang/String");
+
 int wrapped() {
   setbuf(stdout, nullptr);
   setbuf(stderr, nullptr);
@@ -29,37 +37,34 @@ int wrapped() {
 
   jboolean res_bool;
 
-  jclass loader_clazz = env->FindClass("org/apache/commons/daemon/support/DaemonLoader");
+  jclass loader_clazz = jcu::jvm::IdRegistry::getClass<DaemonLoader>(env);
   printf("clazz = %p\n", loader_clazz);
 
-  jmethodID method_load = env->GetStaticMethodID(loader_clazz, "load", "(Ljava/lang/String;[Ljava/lang/String;)Z");
-  jmethodID method_start = env->GetStaticMethodID(loader_clazz, "start", "()Z");
-  jmethodID method_stop = env->GetStaticMethodID(loader_clazz, "stop", "()Z");
-  jstring daemon_class_name = env->NewStringUTF("com.zeronsoftn.client.zbdevd.ZbdevDaemon");
+  jstring daemon_class_name = jcu::jvm::StringTranscoder::newString(env, "com.zeronsoftn.client.zbdevd.ZbdevDaemon");
 
-  jclass class_string = env->FindClass("java/lang/String");
+  jclass class_string = jcu::jvm::IdRegistry::getClass<JavaLangString>(env);
 
-  jobject daemon_args_array = env->NewObjectArray(0, class_string, nullptr);
+  jobjectArray daemon_args_array = env->NewObjectArray(0, class_string, nullptr);
 
-  res_bool = env->CallStaticBooleanMethod(loader_clazz, method_load, daemon_class_name, daemon_args_array);
+  res_bool = DaemonLoaderLoad::call(env, daemon_class_name, daemon_args_array);
   printf("load result = %d\n", res_bool);
 
-  res_bool = env->CallStaticBooleanMethod(loader_clazz, method_start);
+  res_bool = DaemonLoaderStart::call(env);
   printf("start result = %d\n", res_bool);
 
   std::this_thread::sleep_for(std::chrono::milliseconds { 5000 });
   printf("after sleep\n");
 
-  res_bool = env->CallStaticBooleanMethod(loader_clazz, method_stop);
+  res_bool = DaemonLoaderStop::call(env);
   printf("stop result = %d\n", res_bool);
 
-//  std::thread th = std::thread([&java, loader_clazz, method_start]() -> void {
+//  std::thread th = std::thread([&java]() -> void {
 //    JNIEnv* env = nullptr;
 //    bool attached = false;
 //    jint rc = java->attachThreadEnv(&env, &attached);
 //    printf("attachThreadEnv result = %d\n", rc);
 //
-//    jboolean res_bool = env->CallStaticBooleanMethod(loader_clazz, method_start);
+//    jboolean res_bool = DaemonLoaderStart::call(env);
 //    printf("start result = %d\n", res_bool);
 //
 //    if (attached) {
@@ -69,7 +74,7 @@ int wrapped() {
 //
 //  std::this_thread::sleep_for(std::chrono::milliseconds { 5000 });
 //
-//  res_bool = env->CallStaticBooleanMethod(loader_clazz, method_stop);
+//  res_bool = DaemonLoaderStop::call(env);
 //  printf("stop result = %d\n", res_bool);
 //
 //  if (th.joinable()) {
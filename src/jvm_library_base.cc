@@ -26,6 +26,8 @@ class JvmLibraryBase : public JvmLibrary {
   fnJNI_GetCreatedJavaVMs_t fnJNI_GetCreatedJavaVMs_;
   fnJVM_DumpAllStacks_t fnJVM_DumpAllStacks_;
 
+  StartupTrace startup_trace_;
+
  public:
   jint JNI_GetDefaultJavaVMInitArgs(void *vm_args) const override {
     return fnJNI_GetDefaultJavaVMInitArgs_(vm_args);
@@ -86,32 +88,46 @@ class JvmLibraryBase : public JvmLibrary {
     return dso_handle_ ? dso_handle_->getPath() : nullptr;
   }
 
+  const StartupTrace& getStartupTrace() const override {
+    return startup_trace_;
+  }
+
   int load(const JvmLibraryPathInfo& path_info, bool jsig_load = false) {
     int rc;
+    uint64_t begin;
     PointerRef<DsoHandle> dso_handle;
     dso_handle = std::unique_ptr<DsoHandle>(os_handler_->createDsoHandle());
 
+    startup_trace_.reset();
+    startup_trace_.set(StartupTrace::kPhaseFindJvmLibrary, path_info.discovery);
+
     if (jsig_load) {
       PointerRef<DsoHandle> jsig_handle;
       jsig_handle = std::unique_ptr<DsoHandle>(os_handler_->createDsoHandle());
+      begin = StartupTrace::now();
       rc = jsig_handle->open(path_info.jsig_path.c_str());
+      startup_trace_.record(StartupTrace::kPhaseLoadJsig, begin, StartupTrace::now());
       if (rc) {
         return rc;
       }
       dso_handle->addDependency(std::move(jsig_handle));
     }
 
+    begin = StartupTrace::now();
     rc = dso_handle->open(path_info.jvm_path.c_str());
+    startup_trace_.record(StartupTrace::kPhaseLoadJvm, begin, StartupTrace::now());
     if (rc) {
       return rc;
     }
 
     dso_handle_ = std::move(dso_handle);
 
+    begin = StartupTrace::now();
     fnJNI_GetDefaultJavaVMInitArgs_ = (fnJNI_GetDefaultJavaVMInitArgs_t)dso_handle_->getProc("JNI_GetDefaultJavaVMInitArgs");
     fnJNI_CreateJavaVM_ = (fnJNI_CreateJavaVM_t)dso_handle_->getProc("JNI_CreateJavaVM");
     fnJNI_GetCreatedJavaVMs_ = (fnJNI_GetCreatedJavaVMs_t)dso_handle_->getProc("JNI_GetCreatedJavaVMs");
     fnJVM_DumpAllStacks_ = (fnJVM_DumpAllStacks_t)dso_handle_->getProc("JVM_DumpAllStacks");
+    startup_trace_.record(StartupTrace::kPhaseResolveSymbols, begin, StartupTrace::now());
 
     return 0;
   }
@@ -0,0 +1,48 @@
+/**
+ * @file	local_ref.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/26
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+
+#include <jcu-jvm/local_ref.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+
+void stderrLeakHandler(const char* message, long count) {
+  fprintf(stderr, "jcu-jvm: %s: %ld local reference(s) leaked\n", message, count);
+}
+
+std::atomic<LocalRefDebug::LeakHandler> leak_handler(stderrLeakHandler);
+
+thread_local long thread_outstanding = 0;
+
+} // namespace
+
+std::atomic<bool> LocalRefDebug::enabled_(false);
+
+void LocalRefDebug::setLeakHandler(LeakHandler handler) {
+  leak_handler.store(handler ? handler : stderrLeakHandler);
+}
+
+long LocalRefDebug::outstanding() {
+  return thread_outstanding;
+}
+
+void LocalRefDebug::track(long delta) {
+  thread_outstanding += delta;
+}
+
+void LocalRefDebug::report(const char* message, long count) {
+  leak_handler.load()(message, count);
+}
+
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,201 @@
+/**
+ * @file	mapped_buffer_registry.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/23
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <mutex>
+#include <vector>
+
+#include <jcu-jvm/mapped_buffer_registry.h>
+#include <jcu-jvm/method.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+JCU_JVM_CLASS_KEY(JavaNioByteBuffer, "java/nio/ByteBuffer");
+JCU_JVM_TYPED_METHOD_KEY(JavaNioByteBufferAsReadOnlyBuffer, JavaNioByteBuffer, "asReadOnlyBuffer", Object<JavaNioByteBuffer>());
+JCU_JVM_CLASS_KEY(JavaLangRefReferenceQueue, "java/lang/ref/ReferenceQueue");
+JCU_JVM_METHOD_KEY(JavaLangRefReferenceQueueInit, JavaLangRefReferenceQueue, "<init>", "()V");
+JCU_JVM_METHOD_KEY(JavaLangRefReferenceQueuePoll, JavaLangRefReferenceQueue, "poll", "()Ljava/lang/ref/Reference;");
+JCU_JVM_CLASS_KEY(JavaLangRefPhantomReference, "java/lang/ref/PhantomReference");
+JCU_JVM_METHOD_KEY(JavaLangRefPhantomReferenceInit, JavaLangRefPhantomReference, "<init>",
+                   "(Ljava/lang/Object;Ljava/lang/ref/ReferenceQueue;)V");
+} // namespace
+
+class MappedBufferRegistryImpl : public MappedBufferRegistry {
+ private:
+  struct Published {
+    /**
+     * global reference of the PhantomReference of the root buffer
+     */
+    jobject phantom;
+    std::shared_ptr<FileMapping> mapping;
+  };
+
+  PointerRef<OsHandler> os_handler_;
+
+  mutable std::mutex mutex_;
+  jobject queue_;
+  std::vector<Published> published_;
+
+ public:
+  explicit MappedBufferRegistryImpl(PointerRef<OsHandler>&& os_handler)
+      : os_handler_(std::move(os_handler)), queue_(nullptr) {
+  }
+
+  std::shared_ptr<FileMapping> map(const char* path, uint64_t offset, size_t length, int* error) override {
+    std::shared_ptr<FileMapping> mapping(os_handler_->createFileMapping());
+    int rc = mapping->open(path, offset, length);
+    if (error) *error = rc;
+    if (rc) {
+      return nullptr;
+    }
+    return mapping;
+  }
+
+  jobject publish(JNIEnv* env, const std::shared_ptr<FileMapping>& mapping) override {
+    if (!mapping || !mapping->isMapped()) {
+      return nullptr;
+    }
+    reap(env);
+
+    jobject queue = getQueue(env);
+    if (!queue) {
+      return nullptr;
+    }
+
+    // slices and views of a direct buffer keep the root buffer reachable,
+    // so the phantom reference of the root covers everything java derives from it
+    jobject root = env->NewDirectByteBuffer((void*) mapping->data(), (jlong) mapping->size());
+    if (!root) {
+      return nullptr;
+    }
+    jobject read_only = JavaNioByteBufferAsReadOnlyBuffer::call(env, root);
+    if (!read_only) {
+      env->DeleteLocalRef(root);
+      return nullptr;
+    }
+
+    jobject phantom = nullptr;
+    jclass phantom_class = IdRegistry::getClass<JavaLangRefPhantomReference>(env);
+    jmethodID phantom_init = IdRegistry::getMethod<JavaLangRefPhantomReferenceInit>(env);
+    if (phantom_init) {
+      jobject local_ref = env->NewObject(phantom_class, phantom_init, root, queue);
+      if (local_ref) {
+        phantom = env->NewGlobalRef(local_ref);
+        env->DeleteLocalRef(local_ref);
+      }
+    }
+    env->DeleteLocalRef(root);
+    if (!phantom) {
+      env->DeleteLocalRef(read_only);
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Published item;
+    item.phantom = phantom;
+    item.mapping = mapping;
+    published_.emplace_back(std::move(item));
+    return read_only;
+  }
+
+  size_t reap(JNIEnv* env) override {
+    size_t count = 0;
+    jobject queue;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue = queue_;
+    }
+    jmethodID poll = queue ? IdRegistry::getMethod<JavaLangRefReferenceQueuePoll>(env) : nullptr;
+    if (!poll) {
+      return 0;
+    }
+
+    for (;;) {
+      jobject reference = env->CallObjectMethod(queue, poll);
+      if (!reference) {
+        break;
+      }
+      std::shared_ptr<FileMapping> dropped;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = published_.begin(); it != published_.end(); it++) {
+          if (env->IsSameObject(it->phantom, reference)) {
+            env->DeleteGlobalRef(it->phantom);
+            // unmapped outside of the lock if this was the last reference
+            dropped = std::move(it->mapping);
+            published_.erase(it);
+            count++;
+            break;
+          }
+        }
+      }
+      env->DeleteLocalRef(reference);
+    }
+    return count;
+  }
+
+  size_t publishedCount() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return published_.size();
+  }
+
+  void destroy(JNIEnv* env) override {
+    std::vector<Published> published;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      published.swap(published_);
+      if (queue_) {
+        env->DeleteGlobalRef(queue_);
+        queue_ = nullptr;
+      }
+    }
+    for (auto it = published.begin(); it != published.end(); it++) {
+      env->DeleteGlobalRef(it->phantom);
+    }
+  }
+
+ private:
+  jobject getQueue(JNIEnv* env) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (queue_) {
+        return queue_;
+      }
+    }
+    // resolved without the lock, FindClass may run java code
+    jclass clazz = IdRegistry::getClass<JavaLangRefReferenceQueue>(env);
+    jmethodID init = IdRegistry::getMethod<JavaLangRefReferenceQueueInit>(env);
+    if (!init) {
+      return nullptr;
+    }
+    jobject local_ref = env->NewObject(clazz, init);
+    if (!local_ref) {
+      return nullptr;
+    }
+    jobject global_ref = env->NewGlobalRef(local_ref);
+    env->DeleteLocalRef(local_ref);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_) {
+      // created by another thread meanwhile
+      env->DeleteGlobalRef(global_ref);
+    } else {
+      queue_ = global_ref;
+    }
+    return queue_;
+  }
+};
+
+MappedBufferRegistry* MappedBufferRegistry::create(PointerRef<OsHandler> os_handler) {
+  return new MappedBufferRegistryImpl(std::move(os_handler));
+}
+
+} // namespace jvm
+} // namespace jcu
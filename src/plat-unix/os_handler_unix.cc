@@ -8,16 +8,22 @@
  */
 
 #include <list>
+#include <vector>
 #include <cstring>
 
 #include <stdlib.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <jcu-jvm/os_handler.h>
 
 #include <intl_utils.h>
+#include <jvm_discovery_cache.h>
+#include <jvm_cfg.h>
+#include <builtin_dso_handle.h>
 
 #include "dso.h"
 #include "location.h"
@@ -94,30 +100,240 @@ class DsoHandleUnix : public DsoHandle {
   }
 };
 
+class FileMappingUnix : public FileMapping {
+ private:
+  void* base_;
+  size_t mapped_size_;
+  const void* data_;
+  size_t size_;
+
+ public:
+  FileMappingUnix()
+  : base_(nullptr), mapped_size_(0), data_(nullptr), size_(0)
+  {
+  }
+
+  ~FileMappingUnix() override {
+    close();
+  }
+
+  int open(const char* path, uint64_t offset, size_t length) override {
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return errno;
+    }
+    struct stat st = { 0 };
+    if (::fstat(fd, &st) != 0) {
+      int eno = errno;
+      ::close(fd);
+      return eno;
+    }
+    uint64_t file_size = (uint64_t) st.st_size;
+    if (offset >= file_size || (length && length > file_size - offset)) {
+      ::close(fd);
+      return EINVAL;
+    }
+    if (!length) {
+      length = (size_t) (file_size - offset);
+    }
+
+    uint64_t page_size = (uint64_t) ::sysconf(_SC_PAGESIZE);
+    uint64_t aligned_offset = offset - (offset % page_size);
+    size_t delta = (size_t) (offset - aligned_offset);
+    void* base = ::mmap(nullptr, length + delta, PROT_READ, MAP_SHARED, fd, (off_t) aligned_offset);
+    int eno = errno;
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      return eno;
+    }
+
+    base_ = base;
+    mapped_size_ = length + delta;
+    data_ = (const char*) base + delta;
+    size_ = length;
+    return 0;
+  }
+
+  bool isMapped() const override {
+    return base_ != nullptr;
+  }
+
+  const void* data() const override {
+    return data_;
+  }
+
+  size_t size() const override {
+    return size_;
+  }
+
+  int advise(Advice advice) override {
+    int flag;
+    if (!base_) {
+      return EINVAL;
+    }
+    switch (advice) {
+      case kAdviceSequential: flag = MADV_SEQUENTIAL; break;
+      case kAdviceRandom: flag = MADV_RANDOM; break;
+      case kAdviceWillNeed: flag = MADV_WILLNEED; break;
+      case kAdviceDontNeed: flag = MADV_DONTNEED; break;
+      default: flag = MADV_NORMAL; break;
+    }
+    return (::madvise(base_, mapped_size_, flag) == 0) ? 0 : errno;
+  }
+
+  void close() override {
+    if (base_) {
+      ::munmap(base_, mapped_size_);
+      base_ = nullptr;
+      mapped_size_ = 0;
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+};
+
 class OsHandleUnix : public OsHandler {
+ private:
+  std::string discovery_cache_path_;
+  VmSelection vm_selection_;
+  std::string vm_name_;
+
  public:
-  OsHandleUnix() {
+  OsHandleUnix()
+  : vm_selection_(kVmSelectServer)
+  {
     INTL_CFUNC(dso_init)();
   }
 
+  void setDiscoveryCache(const char* cache_file) override {
+    discovery_cache_path_ = cache_file ? cache_file : "";
+  }
+
+  void setVmSelection(VmSelection selection, const char* vm_name) override {
+    vm_selection_ = selection;
+    vm_name_ = vm_name ? vm_name : "";
+  }
+
+  static std::string fileFingerprint(const char* path) {
+    struct stat st = { 0 };
+    if (::stat(path, &st) != 0) {
+      return "";
+    }
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%llx:%llx:%llx:%lld",
+             (unsigned long long) st.st_dev, (unsigned long long) st.st_ino,
+             (unsigned long long) st.st_size, (long long) st.st_mtime);
+    return buffer;
+  }
+
+  std::string getFileFingerprint(const char* path) const override {
+    return fileFingerprint(path);
+  }
+
   DsoHandle *createDsoHandle() const override {
     return new DsoHandleUnix();
   }
 
-  static std::string findJvmFromJavaHome(const char* java_home_path) {
-    for(char* const * it = INTL_CFUNC(location_jvm_default); *it != nullptr; it++) {
-      struct stat st = { 0 };
-      std::string item(*it);
-      item = intl::stringReplace<char>(item, "JAVA_HOME", java_home_path);
-      if (stat(item.c_str(), &st) == 0) {
-        return item;
+  static bool fileExists(const std::string& path) {
+    struct stat st = { 0 };
+    return ::stat(path.c_str(), &st) == 0;
+  }
+
+  std::string findJvmFromJvmCfg(const std::string& java_home, std::string* vm_name) const {
+    intl::JvmCfg cfg;
+    bool cfg_loaded = false;
+    for (char* const * it = INTL_CFUNC(location_jvm_cfg); *it != nullptr && !cfg_loaded; it++) {
+      std::string item = intl::stringReplace<char>(*it, "$JAVA_HOME", java_home);
+      cfg_loaded = cfg.load(item.c_str());
+    }
+    if (!cfg_loaded) {
+      return "";
+    }
+
+    std::vector<std::string> names = cfg.candidates(vm_selection_, vm_name_);
+    for (auto name = names.cbegin(); name != names.cend(); name++) {
+      for (char* const * it = INTL_CFUNC(location_jvm_configured); *it != nullptr; it++) {
+        std::string item = intl::stringReplace<char>(*it, "$JAVA_HOME", java_home);
+        item = intl::stringReplace<char>(item, "$VM_NAME", *name);
+        if (fileExists(item)) {
+          *vm_name = *name;
+          return item;
+        }
       }
     }
     return "";
   }
 
-  JvmLibraryPathInfo findJvmLibrary(const char* jvm_dll_path, const char* java_home_path) const {
+  std::string findJvmFromJavaHome(const std::string& java_home, std::string* vm_name) const {
+    std::string found = findJvmFromJvmCfg(java_home, vm_name);
+    if (!found.empty()) {
+      return found;
+    }
+
+    // no jvm.cfg: walk the defaults, paths of the preferred vm first
+    std::string preferred = intl::JvmCfg::preferredName(vm_selection_, vm_name_);
+    std::string preferred_dir = "/" + preferred + "/";
+    for (int pass = 0; pass < 2; pass++) {
+      if (pass == 1 && vm_selection_ == kVmSelectExplicit) {
+        break;
+      }
+      for (char* const * it = INTL_CFUNC(location_jvm_default); *it != nullptr; it++) {
+        bool is_preferred = !preferred.empty() && std::strstr(*it, preferred_dir.c_str()) != nullptr;
+        if (is_preferred != (pass == 0)) {
+          continue;
+        }
+        std::string item = intl::stringReplace<char>(*it, "$JAVA_HOME", java_home);
+        if (fileExists(item)) {
+          if (is_preferred) {
+            *vm_name = preferred;
+          }
+          return item;
+        }
+      }
+    }
+    return "";
+  }
+
+  std::string discoveryCacheKey(const std::string& java_home) const {
+    if (vm_selection_ == kVmSelectServer) {
+      return java_home;
+    }
+    return java_home + "|" + intl::JvmCfg::preferredName(vm_selection_, vm_name_);
+  }
+
+  static std::string findJsigFromJvm(const std::string& jvm_path) {
+    std::string expect_dir(jvm_path);
+    for (int trycount = 0; trycount < 2; trycount++) {
+      struct stat st = { 0 };
+      const char* last_slash = std::strrchr(expect_dir.c_str(), '/');
+      if (last_slash) {
+        expect_dir = std::string(expect_dir.c_str(), last_slash);
+        std::string temp(expect_dir);
+        temp.append("/libjsig.so");
+        if (::stat(temp.c_str(), &st) == 0) {
+          return temp;
+        }
+      } else {
+        break;
+      }
+    }
+    return "libjsig.so";
+  }
+
+  JvmLibraryPathInfo findJvmLibrary(const char* jvm_dll_path, const char* java_home_path) const override {
+    uint64_t begin = StartupTrace::now();
+    JvmLibraryPathInfo info = probeJvmLibrary(jvm_dll_path, java_home_path);
+    info.discovery.recorded = true;
+    info.discovery.begin_ns = begin;
+    info.discovery.duration_ns = StartupTrace::now() - begin;
+    return info;
+  }
+
+  JvmLibraryPathInfo probeJvmLibrary(const char* jvm_dll_path, const char* java_home_path) const {
     JvmLibraryPathInfo info;
+    bool use_cache = false;
 
     if (jvm_dll_path) {
       info.jvm_path = jvm_dll_path;
@@ -127,51 +343,77 @@ class OsHandleUnix : public OsHandler {
     }
 
     if (info.jvm_path.empty()) {
-      if (!info.java_home.empty()) {
-        info.jvm_path = findJvmFromJavaHome(info.java_home.c_str());
-      } else {
+      if (info.java_home.empty()) {
         const char* env_java_home = getenv("JAVA_HOME");
         if (env_java_home) {
           info.java_home = env_java_home;
-          info.jvm_path = findJvmFromJavaHome(env_java_home);
         }
       }
+      if (!info.java_home.empty()) {
+        use_cache = !discovery_cache_path_.empty();
+        if (use_cache) {
+          intl::JvmDiscoveryCache cache(discovery_cache_path_);
+          intl::JvmDiscoveryCacheEntry entry;
+          if (cache.lookup(discoveryCacheKey(info.java_home), &entry) && !entry.fingerprint.empty()
+              && entry.fingerprint == fileFingerprint(entry.jvm_path.c_str())) {
+            info.jvm_path = std::move(entry.jvm_path);
+            info.jsig_path = std::move(entry.jsig_path);
+            info.vm_name = std::move(entry.vm_name);
+            return info;
+          }
+        }
+        info.jvm_path = findJvmFromJavaHome(info.java_home, &info.vm_name);
+      }
     }
 
     if (info.jvm_path.empty()) {
+      use_cache = false;
       info.jvm_path = "libjvm.so";
     }
 
-    std::string expect_dir(info.jvm_path);
-    for (int trycount = 0; trycount < 2; trycount++) {
-      struct stat st = { 0 };
-      const char* last_slash = std::strrchr(expect_dir.c_str(), '/');
-      if (last_slash) {
-        expect_dir = std::string(expect_dir.c_str(), last_slash);
-        std::string temp(expect_dir);
-        temp.append("/libjsig.so");
-        if (::stat(temp.c_str(), &st) == 0) {
-          info.jsig_path = temp;
-          break;
-        }
-      } else {
-        break;
+    info.jsig_path = findJsigFromJvm(info.jvm_path);
+
+    if (use_cache) {
+      intl::JvmDiscoveryCacheEntry entry;
+      entry.key = discoveryCacheKey(info.java_home);
+      entry.jvm_path = info.jvm_path;
+      entry.jsig_path = info.jsig_path;
+      entry.vm_name = info.vm_name;
+      entry.fingerprint = fileFingerprint(info.jvm_path.c_str());
+      if (!entry.fingerprint.empty()) {
+        intl::JvmDiscoveryCache cache(discovery_cache_path_);
+        cache.store(entry, std::to_string(getCurrentPid()));
       }
     }
-    if (info.jsig_path.empty()) {
-      info.jsig_path = "libjsig.so";
-    }
 
-    return std::move(info);
+    return info;
   }
 
   DsoHandle* loadLibrary(DsoHandle* handle, const char* path) const override {
-    if (!handle)
-      handle = new DsoHandleUnix();
+    if (!handle) {
+      if (BuiltinLibraries::find(path)) {
+        handle = new intl::BuiltinDsoHandle(this);
+      } else {
+        handle = new DsoHandleUnix();
+      }
+    }
     handle->open(path);
     return handle;
   }
 
+  void* getProcessSymbol(const char* name) const override {
+    dso_handle self = ::INTL_CFUNC(dso_link)(nullptr);
+    if (!self)
+      return nullptr;
+    void* symbol = ::INTL_CFUNC(dso_symbol)(self, name);
+    ::INTL_CFUNC(dso_unlink)(self);
+    return symbol;
+  }
+
+  FileMapping* createFileMapping() const override {
+    return new FileMappingUnix();
+  }
+
   int getCurrentPid() const override {
     return ::getpid();
   }
@@ -0,0 +1,36 @@
+/**
+ * @file	thread_key_unix.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/10
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <thread_key.h>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+ThreadKey::ThreadKey(Destructor destructor) {
+  valid_ = (::pthread_key_create(&key_, destructor) == 0);
+}
+
+ThreadKey::~ThreadKey() {
+  if (valid_) {
+    ::pthread_key_delete(key_);
+  }
+}
+
+void* ThreadKey::get() const {
+  return valid_ ? ::pthread_getspecific(key_) : nullptr;
+}
+
+bool ThreadKey::set(void* value) {
+  return valid_ && (::pthread_setspecific(key_, value) == 0);
+}
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
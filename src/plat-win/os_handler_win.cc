@@ -9,12 +9,17 @@
 
 #include <list>
 #include <vector>
+#include <fstream>
+#include <sstream>
 #include <windows.h>
 #include <tlhelp32.h>
 
 #include <jcu-jvm/os_handler.h>
 
 #include <intl_utils.h>
+#include <jvm_discovery_cache.h>
+#include <jvm_cfg.h>
+#include <builtin_dso_handle.h>
 
 namespace jcu {
 namespace jvm {
@@ -103,57 +108,267 @@ class DsoHandleWin : public DsoHandle {
   }
 };
 
+class FileMappingWin : public FileMapping {
+ private:
+  void* base_;
+  size_t mapped_size_;
+  const void* data_;
+  size_t size_;
+
+ public:
+  FileMappingWin()
+      : base_(nullptr), mapped_size_(0), data_(nullptr), size_(0) {
+  }
+
+  ~FileMappingWin() override {
+    close();
+  }
+
+  int open(const char* path, uint64_t offset, size_t length) override {
+    close();
+
+    auto spath = intl::utf8ToSystem(path);
+    HANDLE file = ::CreateFile(spath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return (int) ::GetLastError();
+    }
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(file, &file_size)) {
+      DWORD eno = ::GetLastError();
+      ::CloseHandle(file);
+      return (int) eno;
+    }
+    if (offset >= (uint64_t) file_size.QuadPart || (length && length > (uint64_t) file_size.QuadPart - offset)) {
+      ::CloseHandle(file);
+      return ERROR_INVALID_PARAMETER;
+    }
+    if (!length) {
+      length = (size_t) ((uint64_t) file_size.QuadPart - offset);
+    }
+
+    HANDLE mapping = ::CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    DWORD eno = ::GetLastError();
+    ::CloseHandle(file);
+    if (!mapping) {
+      return (int) eno;
+    }
+
+    SYSTEM_INFO system_info;
+    ::GetSystemInfo(&system_info);
+    uint64_t granularity = system_info.dwAllocationGranularity;
+    uint64_t aligned_offset = offset - (offset % granularity);
+    size_t delta = (size_t) (offset - aligned_offset);
+    void* base = ::MapViewOfFile(mapping, FILE_MAP_READ,
+                                 (DWORD) (aligned_offset >> 32), (DWORD) aligned_offset, length + delta);
+    eno = ::GetLastError();
+    // the view keeps the section alive
+    ::CloseHandle(mapping);
+    if (!base) {
+      return (int) eno;
+    }
+
+    base_ = base;
+    mapped_size_ = length + delta;
+    data_ = (const char*) base + delta;
+    size_ = length;
+    return 0;
+  }
+
+  bool isMapped() const override {
+    return base_ != nullptr;
+  }
+
+  const void* data() const override {
+    return data_;
+  }
+
+  size_t size() const override {
+    return size_;
+  }
+
+  int advise(Advice advice) override {
+    if (!base_) {
+      return ERROR_INVALID_PARAMETER;
+    }
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+    if (advice == kAdviceWillNeed) {
+      WIN32_MEMORY_RANGE_ENTRY range;
+      range.VirtualAddress = base_;
+      range.NumberOfBytes = mapped_size_;
+      return ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0) ? 0 : (int) ::GetLastError();
+    }
+#endif
+    if (advice == kAdviceNormal || advice == kAdviceSequential || advice == kAdviceRandom) {
+      // no per-range equivalent, the access pattern hints are only given at CreateFile
+      return 0;
+    }
+    return ERROR_NOT_SUPPORTED;
+  }
+
+  void close() override {
+    if (base_) {
+      ::UnmapViewOfFile(base_);
+      base_ = nullptr;
+      mapped_size_ = 0;
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+};
+
 class OsHandleWin : public OsHandler {
+ private:
+  std::string discovery_cache_path_;
+  VmSelection vm_selection_;
+  std::string vm_name_;
+
  public:
-  OsHandleWin() {
+  OsHandleWin()
+      : vm_selection_(kVmSelectServer) {
+  }
+
+  void setDiscoveryCache(const char* cache_file) override {
+    discovery_cache_path_ = cache_file ? cache_file : "";
+  }
+
+  void setVmSelection(VmSelection selection, const char* vm_name) override {
+    vm_selection_ = selection;
+    vm_name_ = vm_name ? vm_name : "";
+  }
+
+  static std::string fileFingerprint(const TCHAR* path) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!::GetFileAttributesEx(path, GetFileExInfoStandard, &data)) {
+      return "";
+    }
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%08lx%08lx:%08lx%08lx",
+             data.nFileSizeHigh, data.nFileSizeLow,
+             data.ftLastWriteTime.dwHighDateTime, data.ftLastWriteTime.dwLowDateTime);
+    return buffer;
+  }
+
+  std::string getFileFingerprint(const char* path) const override {
+    return fileFingerprint(intl::utf8ToSystem(path).c_str());
   }
 
   DsoHandle *createDsoHandle() const override {
     return new DsoHandleWin();
   }
 
-  static std::basic_string<TCHAR> findJvmFromJavaHome(const TCHAR *java_home_path) {
-    TCHAR temp_path[MAX_PATH];
-    size_t java_home_len = _tcslen(java_home_path);
-    int rc;
-    _tcscpy_s(temp_path, java_home_path);
-    if (temp_path[java_home_len - 1] == '\\') {
-      temp_path[--java_home_len] = 0;
+  static bool fileExists(const std::basic_string<TCHAR>& path) {
+    return ::GetFileAttributes(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+  }
+
+  std::basic_string<TCHAR> findJvmFromJavaHome(const TCHAR *java_home_path, std::string* vm_name) const {
+    std::basic_string<TCHAR> java_home(java_home_path);
+    if (!java_home.empty() && java_home.back() == _T('\\')) {
+      java_home.pop_back();
     }
-    _tcscat_s(temp_path, _T("\\bin\\server\\jvm.dll"));
-    if (::GetFileAttributes(temp_path) != INVALID_FILE_ATTRIBUTES) {
-      return temp_path;
+
+    static const TCHAR* cfg_locations[] = {
+        _T("\\lib\\jvm.cfg"),
+        _T("\\jre\\lib\\jvm.cfg"),
+        _T("\\lib\\") _T(CPU) _T("\\jvm.cfg"),
+        _T("\\jre\\lib\\") _T(CPU) _T("\\jvm.cfg"),
+    };
+    intl::JvmCfg cfg;
+    bool cfg_loaded = false;
+    for (size_t i = 0; i < sizeof(cfg_locations) / sizeof(cfg_locations[0]) && !cfg_loaded; i++) {
+      std::ifstream file((java_home + cfg_locations[i]).c_str());
+      if (file) {
+        std::stringstream content;
+        content << file.rdbuf();
+        cfg.parse(content.str());
+        cfg_loaded = true;
+      }
+    }
+
+    std::vector<std::string> names;
+    if (cfg_loaded) {
+      names = cfg.candidates(vm_selection_, vm_name_);
+    } else {
+      names.push_back(intl::JvmCfg::preferredName(vm_selection_, vm_name_));
+      if (vm_selection_ != kVmSelectExplicit) {
+        static const char* defaults[] = {"server", "client", "minimal"};
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+          if (names.front() != defaults[i]) {
+            names.push_back(defaults[i]);
+          }
+        }
+      }
     }
 
-    temp_path[java_home_len] = 0;
-    _tcscat_s(temp_path, _T("\\jre\\bin\\server\\jvm.dll"));
-    if (::GetFileAttributes(temp_path) != INVALID_FILE_ATTRIBUTES) {
-      return temp_path;
+    for (auto it = names.cbegin(); it != names.cend(); it++) {
+      std::basic_string<TCHAR> name = intl::utf8ToSystem(it->c_str());
+      std::basic_string<TCHAR> candidates[] = {
+          java_home + _T("\\bin\\") + name + _T("\\jvm.dll"),
+          java_home + _T("\\jre\\bin\\") + name + _T("\\jvm.dll"),
+      };
+      for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        if (fileExists(candidates[i])) {
+          *vm_name = *it;
+          return candidates[i];
+        }
+      }
     }
 
     return _T("");
   }
 
-  JvmLibraryPathInfo findJvmLibrary(const char* jvm_dll_path, const char* java_home_path) const {
+  std::string discoveryCacheKey(const std::string& java_home) const {
+    if (vm_selection_ == kVmSelectServer) {
+      return java_home;
+    }
+    return java_home + "|" + intl::JvmCfg::preferredName(vm_selection_, vm_name_);
+  }
+
+  JvmLibraryPathInfo findJvmLibrary(const char* jvm_dll_path, const char* java_home_path) const override {
+    uint64_t begin = StartupTrace::now();
+    JvmLibraryPathInfo info = probeJvmLibrary(jvm_dll_path, java_home_path);
+    info.discovery.recorded = true;
+    info.discovery.begin_ns = begin;
+    info.discovery.duration_ns = StartupTrace::now() - begin;
+    return info;
+  }
+
+  JvmLibraryPathInfo probeJvmLibrary(const char* jvm_dll_path, const char* java_home_path) const {
     JvmLibraryPathInfo info;
 
     auto jvm_dll_path_string = intl::utf8ToSystem(jvm_dll_path);
     std::basic_string<TCHAR> jsig_dll_path_string;
     auto java_home_path_string = intl::utf8ToSystem(java_home_path);
+    bool use_cache = false;
 
     if (jvm_dll_path_string.empty()) {
-      if (!java_home_path_string.empty()) {
-        jvm_dll_path_string = findJvmFromJavaHome(java_home_path_string.c_str());
-      } else {
+      if (java_home_path_string.empty()) {
         TCHAR env_java_home[MAX_PATH];
         if (::GetEnvironmentVariable(_T("JAVA_HOME"), env_java_home, MAX_PATH)) {
           java_home_path_string = env_java_home;
-          jvm_dll_path_string = findJvmFromJavaHome(env_java_home);
         }
       }
+      if (!java_home_path_string.empty()) {
+        use_cache = !discovery_cache_path_.empty();
+        if (use_cache) {
+          intl::JvmDiscoveryCache cache(discovery_cache_path_);
+          intl::JvmDiscoveryCacheEntry entry;
+          std::string java_home_utf8 = intl::systemToUtf8(java_home_path_string.c_str(), java_home_path_string.length());
+          if (cache.lookup(discoveryCacheKey(java_home_utf8), &entry) && !entry.fingerprint.empty()
+              && entry.fingerprint == fileFingerprint(intl::utf8ToSystem(entry.jvm_path.c_str()).c_str())) {
+            info.java_home = std::move(java_home_utf8);
+            info.jvm_path = std::move(entry.jvm_path);
+            info.jsig_path = std::move(entry.jsig_path);
+            info.vm_name = std::move(entry.vm_name);
+            return info;
+          }
+        }
+        jvm_dll_path_string = findJvmFromJavaHome(java_home_path_string.c_str(), &info.vm_name);
+      }
     }
 
     if (jvm_dll_path_string.empty()) {
+      use_cache = false;
       jvm_dll_path_string = _T("jvm.dll");
     }
 
@@ -183,16 +398,42 @@ class OsHandleWin : public OsHandler {
     info.jsig_path = intl::systemToUtf8(jsig_dll_path_string.c_str(), jsig_dll_path_string.length());
     info.java_home = intl::systemToUtf8(java_home_path_string.c_str(), java_home_path_string.length());
 
-    return std::move(info);
+    if (use_cache) {
+      intl::JvmDiscoveryCacheEntry entry;
+      entry.key = discoveryCacheKey(info.java_home);
+      entry.jvm_path = info.jvm_path;
+      entry.jsig_path = info.jsig_path;
+      entry.vm_name = info.vm_name;
+      entry.fingerprint = fileFingerprint(jvm_dll_path_string.c_str());
+      if (!entry.fingerprint.empty()) {
+        intl::JvmDiscoveryCache cache(discovery_cache_path_);
+        cache.store(entry, std::to_string(getCurrentPid()));
+      }
+    }
+
+    return info;
   }
 
   DsoHandle* loadLibrary(DsoHandle* handle, const char* path) const override {
-    if (!handle)
-      handle = new DsoHandleWin();
+    if (!handle) {
+      if (BuiltinLibraries::find(path)) {
+        handle = new intl::BuiltinDsoHandle(this);
+      } else {
+        handle = new DsoHandleWin();
+      }
+    }
     handle->open(path);
     return handle;
   }
 
+  void* getProcessSymbol(const char* name) const override {
+    return (void *) ::GetProcAddress(::GetModuleHandle(nullptr), name);
+  }
+
+  FileMapping* createFileMapping() const override {
+    return new FileMappingWin();
+  }
+
   int getCurrentPid() const override {
     return ::GetCurrentProcessId();
   }
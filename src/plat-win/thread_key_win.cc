@@ -0,0 +1,38 @@
+/**
+ * @file	thread_key_win.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/10
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <thread_key.h>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+ThreadKey::ThreadKey(Destructor destructor) {
+  // FLS callbacks are invoked at thread exit like pthread key destructors.
+  key_ = ::FlsAlloc((PFLS_CALLBACK_FUNCTION) destructor);
+  valid_ = (key_ != FLS_OUT_OF_INDEXES);
+}
+
+ThreadKey::~ThreadKey() {
+  if (valid_) {
+    ::FlsFree(key_);
+  }
+}
+
+void* ThreadKey::get() const {
+  return valid_ ? ::FlsGetValue(key_) : nullptr;
+}
+
+bool ThreadKey::set(void* value) {
+  return valid_ && ::FlsSetValue(key_, value);
+}
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
@@ -13,12 +13,13 @@
 
 namespace jcu {
 namespace jvm {
-namespace intl {
 
 MemoryPool* createSimpleMemoryPool() {
-  return new SimpleMemoryPool();
+  return new intl::SimpleMemoryPool();
 }
 
+namespace intl {
+
 SimpleMemoryPool::SimpleMemoryPool() {
 }
 
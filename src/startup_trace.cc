@@ -0,0 +1,79 @@
+/**
+ * @file	startup_trace.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/19
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+
+#include <chrono>
+
+#include <jcu-jvm/startup_trace.h>
+
+namespace jcu {
+namespace jvm {
+
+uint64_t StartupTrace::totalNs() const {
+  uint64_t total = 0;
+  for (int i = 0; i < kPhaseCount; i++) {
+    if (timings_[i].recorded) {
+      total += timings_[i].duration_ns;
+    }
+  }
+  return total;
+}
+
+std::string StartupTrace::toJson() const {
+  uint64_t origin = 0;
+  bool has_origin = false;
+  for (int i = 0; i < kPhaseCount; i++) {
+    if (timings_[i].recorded && (!has_origin || timings_[i].begin_ns < origin)) {
+      origin = timings_[i].begin_ns;
+      has_origin = true;
+    }
+  }
+
+  char buffer[160];
+  std::string json;
+  snprintf(buffer, sizeof(buffer), "{\"total_ns\":%llu,\"phases\":[", (unsigned long long) totalNs());
+  json.append(buffer);
+  bool first = true;
+  for (int i = 0; i < kPhaseCount; i++) {
+    const Timing& timing = timings_[i];
+    if (!timing.recorded) {
+      continue;
+    }
+    snprintf(buffer, sizeof(buffer), "%s{\"name\":\"%s\",\"offset_ns\":%llu,\"duration_ns\":%llu}",
+             first ? "" : ",", phaseName((Phase) i),
+             (unsigned long long) (timing.begin_ns - origin), (unsigned long long) timing.duration_ns);
+    json.append(buffer);
+    first = false;
+  }
+  json.append("]}");
+  return json;
+}
+
+const char* StartupTrace::phaseName(Phase phase) {
+  switch (phase) {
+    case kPhaseFindJvmLibrary: return "find_jvm_library";
+    case kPhaseLoadJsig: return "load_jsig";
+    case kPhaseLoadJvm: return "load_jvm";
+    case kPhaseResolveSymbols: return "resolve_symbols";
+    case kPhaseGetDefaultInitArgs: return "get_default_init_args";
+    case kPhaseBuildOptions: return "build_options";
+    case kPhaseCreateJavaVM: return "create_java_vm";
+    case kPhaseFirstFindClass: return "first_find_class";
+    default: return "unknown";
+  }
+}
+
+uint64_t StartupTrace::now() {
+  return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace jvm
+} // namespace jcu
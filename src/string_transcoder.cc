@@ -0,0 +1,508 @@
+/**
+ * @file	string_transcoder.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/25
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include <jcu-jvm/string_transcoder.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JCU_JVM_TRANSCODER_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define JCU_JVM_TRANSCODER_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define JCU_JVM_TARGET_AVX2
+#else
+#define JCU_JVM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define JCU_JVM_TRANSCODER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+
+/**
+ * Vectorized ASCII kernels. Each one handles whole blocks from the start of
+ * src, then the rest of the run up to the first non ASCII unit with the
+ * scalar kernel. The caller decodes from there.
+ */
+struct Kernels {
+  const char* name;
+  /**
+   * length of the prefix of bytes in 0x01..0x7f
+   */
+  size_t (*ascii_span)(const char* src, size_t length);
+  /**
+   * widen bytes in 0x00..0x7f to UTF-16
+   */
+  size_t (*widen)(const char* src, size_t length, jchar* dst);
+  /**
+   * narrow UTF-16 units in 0x0000..0x007f to bytes
+   */
+  size_t (*narrow)(const jchar* src, size_t length, char* dst);
+};
+
+size_t scalarAsciiSpan(const char* src, size_t length) {
+  size_t i = 0;
+  while (i < length && (unsigned char) (src[i] - 1) < 0x7f) {
+    i++;
+  }
+  return i;
+}
+
+size_t scalarWiden(const char* src, size_t length, jchar* dst) {
+  size_t i = 0;
+  while (i < length && (unsigned char) src[i] < 0x80) {
+    dst[i] = (jchar) src[i];
+    i++;
+  }
+  return i;
+}
+
+size_t scalarNarrow(const jchar* src, size_t length, char* dst) {
+  size_t i = 0;
+  while (i < length && src[i] < 0x80) {
+    dst[i] = (char) src[i];
+    i++;
+  }
+  return i;
+}
+
+#if defined(JCU_JVM_TRANSCODER_SSE2)
+size_t sse2AsciiSpan(const char* src, size_t length) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+    int mask = _mm_movemask_epi8(v) | _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+    if (mask) {
+      while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+      }
+      return i;
+    }
+  }
+  return i + scalarAsciiSpan(src + i, length - i);
+}
+
+size_t sse2Widen(const char* src, size_t length, jchar* dst) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+    if (_mm_movemask_epi8(v)) {
+      break;
+    }
+    _mm_storeu_si128((__m128i*) (dst + i), _mm_unpacklo_epi8(v, zero));
+    _mm_storeu_si128((__m128i*) (dst + i + 8), _mm_unpackhi_epi8(v, zero));
+  }
+  return i + scalarWiden(src + i, length - i, dst + i);
+}
+
+size_t sse2Narrow(const jchar* src, size_t length, char* dst) {
+  const __m128i non_ascii = _mm_set1_epi16((short) 0xff80);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*) (src + i));
+    __m128i b = _mm_loadu_si128((const __m128i*) (src + i + 8));
+    // packus saturates as signed, units from 0x8000 would become 0, so test the bits first
+    __m128i high = _mm_and_si128(_mm_or_si128(a, b), non_ascii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xffff) {
+      break;
+    }
+    _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(a, b));
+  }
+  return i + scalarNarrow(src + i, length - i, dst + i);
+}
+#endif
+
+#if defined(JCU_JVM_TRANSCODER_AVX2)
+JCU_JVM_TARGET_AVX2 size_t avx2AsciiSpan(const char* src, size_t length) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*) (src + i));
+    uint32_t mask = (uint32_t) _mm256_movemask_epi8(v) | (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+    if (mask) {
+      while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+      }
+      return i;
+    }
+  }
+  return i + sse2AsciiSpan(src + i, length - i);
+}
+
+JCU_JVM_TARGET_AVX2 size_t avx2Widen(const char* src, size_t length, jchar* dst) {
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*) (src + i));
+    if (_mm256_movemask_epi8(v)) {
+      break;
+    }
+    _mm256_storeu_si256((__m256i*) (dst + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+    _mm256_storeu_si256((__m256i*) (dst + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+  }
+  return i + sse2Widen(src + i, length - i, dst + i);
+}
+
+JCU_JVM_TARGET_AVX2 size_t avx2Narrow(const jchar* src, size_t length, char* dst) {
+  const __m256i non_ascii = _mm256_set1_epi16((short) 0xff80);
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*) (src + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*) (src + i + 16));
+    if (!_mm256_testz_si256(_mm256_or_si256(a, b), non_ascii)) {
+      break;
+    }
+    // packus works per 128-bit lane, restore the element order afterwards
+    _mm256_storeu_si256((__m256i*) (dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8));
+  }
+  return i + sse2Narrow(src + i, length - i, dst + i);
+}
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  // OSXSAVE and AVX, then the os must save the ymm state
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+#if defined(JCU_JVM_TRANSCODER_NEON)
+size_t neonAsciiSpan(const char* src, size_t length) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t*) (src + i));
+    uint8x16_t bad = vorrq_u8(vcgeq_u8(v, vdupq_n_u8(0x80)), vceqq_u8(v, vdupq_n_u8(0)));
+    if (vmaxvq_u8(bad)) {
+      break;
+    }
+  }
+  return i + scalarAsciiSpan(src + i, length - i);
+}
+
+size_t neonWiden(const char* src, size_t length, jchar* dst) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t*) (src + i));
+    if (vmaxvq_u8(v) >= 0x80) {
+      break;
+    }
+    vst1q_u16((uint16_t*) (dst + i), vmovl_u8(vget_low_u8(v)));
+    vst1q_u16((uint16_t*) (dst + i + 8), vmovl_u8(vget_high_u8(v)));
+  }
+  return i + scalarWiden(src + i, length - i, dst + i);
+}
+
+size_t neonNarrow(const jchar* src, size_t length, char* dst) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    uint16x8_t a = vld1q_u16((const uint16_t*) (src + i));
+    uint16x8_t b = vld1q_u16((const uint16_t*) (src + i + 8));
+    if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80) {
+      break;
+    }
+    vst1q_u8((uint8_t*) (dst + i), vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+  }
+  return i + scalarNarrow(src + i, length - i, dst + i);
+}
+#endif
+
+Kernels selectKernels() {
+#if defined(JCU_JVM_TRANSCODER_AVX2)
+  if (cpuHasAvx2()) {
+    return Kernels{"avx2", avx2AsciiSpan, avx2Widen, avx2Narrow};
+  }
+#endif
+#if defined(JCU_JVM_TRANSCODER_SSE2)
+  return Kernels{"sse2", sse2AsciiSpan, sse2Widen, sse2Narrow};
+#elif defined(JCU_JVM_TRANSCODER_NEON)
+  return Kernels{"neon", neonAsciiSpan, neonWiden, neonNarrow};
+#else
+  return Kernels{"scalar", scalarAsciiSpan, scalarWiden, scalarNarrow};
+#endif
+}
+
+const Kernels& kernels() {
+  static const Kernels selected = selectKernels();
+  return selected;
+}
+
+const uint32_t kReplacement = 0xfffd;
+
+inline bool isContinuation(unsigned char c) {
+  return (c & 0xc0) == 0x80;
+}
+
+/**
+ * Decode one sequence, invalid input consumes its maximal valid prefix
+ * (at least one byte) and yields U+FFFD.
+ * @param modified accept C0 80 and encoded surrogates (modified UTF-8)
+ */
+uint32_t decodeUtf8(const unsigned char* src, size_t length, size_t* consumed, bool modified) {
+  unsigned char c = src[0];
+  *consumed = 1;
+  if (c < 0x80) {
+    return c;
+  }
+
+  size_t need;
+  uint32_t cp;
+  unsigned char lower = 0x80;
+  unsigned char upper = 0xbf;
+  if (c >= 0xc2 && c <= 0xdf) {
+    need = 1;
+    cp = c & 0x1f;
+  } else if (c == 0xc0 && modified) {
+    if (length >= 2 && src[1] == 0x80) {
+      *consumed = 2;
+      return 0;
+    }
+    return kReplacement;
+  } else if (c >= 0xe0 && c <= 0xef) {
+    need = 2;
+    cp = c & 0x0f;
+    if (c == 0xe0) lower = 0xa0;
+    if (c == 0xed && !modified) upper = 0x9f;
+  } else if (c >= 0xf0 && c <= 0xf4) {
+    need = 3;
+    cp = c & 0x07;
+    if (c == 0xf0) lower = 0x90;
+    if (c == 0xf4) upper = 0x8f;
+  } else {
+    return kReplacement;
+  }
+
+  for (size_t i = 1; i <= need; i++) {
+    if (i >= length) {
+      return kReplacement;
+    }
+    unsigned char next = src[i];
+    if (i == 1 ? (next < lower || next > upper) : !isContinuation(next)) {
+      return kReplacement;
+    }
+    cp = (cp << 6) | (next & 0x3f);
+    *consumed = i + 1;
+  }
+  return cp;
+}
+
+inline size_t putUtf8(uint32_t cp, char* dst) {
+  if (cp < 0x80) {
+    dst[0] = (char) cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    dst[0] = (char) (0xc0 | (cp >> 6));
+    dst[1] = (char) (0x80 | (cp & 0x3f));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    dst[0] = (char) (0xe0 | (cp >> 12));
+    dst[1] = (char) (0x80 | ((cp >> 6) & 0x3f));
+    dst[2] = (char) (0x80 | (cp & 0x3f));
+    return 3;
+  }
+  dst[0] = (char) (0xf0 | (cp >> 18));
+  dst[1] = (char) (0x80 | ((cp >> 12) & 0x3f));
+  dst[2] = (char) (0x80 | ((cp >> 6) & 0x3f));
+  dst[3] = (char) (0x80 | (cp & 0x3f));
+  return 4;
+}
+
+inline size_t putUtf16(uint32_t cp, jchar* dst) {
+  if (cp < 0x10000) {
+    dst[0] = (jchar) cp;
+    return 1;
+  }
+  cp -= 0x10000;
+  dst[0] = (jchar) (0xd800 | (cp >> 10));
+  dst[1] = (jchar) (0xdc00 | (cp & 0x3ff));
+  return 2;
+}
+
+inline size_t putModifiedUtf8(uint32_t cp, char* dst) {
+  if (cp == 0) {
+    dst[0] = (char) 0xc0;
+    dst[1] = (char) 0x80;
+    return 2;
+  }
+  if (cp < 0x10000) {
+    return putUtf8(cp, dst);
+  }
+  cp -= 0x10000;
+  size_t n = putUtf8(0xd800 | (cp >> 10), dst);
+  return n + putUtf8(0xdc00 | (cp & 0x3ff), dst + n);
+}
+
+inline bool isHighSurrogate(uint32_t u) {
+  return u >= 0xd800 && u <= 0xdbff;
+}
+
+inline bool isLowSurrogate(uint32_t u) {
+  return u >= 0xdc00 && u <= 0xdfff;
+}
+
+} // namespace
+
+size_t StringTranscoder::utf8ToUtf16(const char* src, size_t length, jchar* dst) {
+  const Kernels& k = kernels();
+  size_t i = 0;
+  size_t o = 0;
+  while (i < length) {
+    size_t n = k.widen(src + i, length - i, dst + o);
+    i += n;
+    o += n;
+    if (i >= length) {
+      break;
+    }
+    size_t consumed;
+    uint32_t cp = decodeUtf8((const unsigned char*) src + i, length - i, &consumed, false);
+    i += consumed;
+    o += putUtf16(cp, dst + o);
+  }
+  return o;
+}
+
+size_t StringTranscoder::utf16ToUtf8(const jchar* src, size_t length, char* dst) {
+  const Kernels& k = kernels();
+  size_t i = 0;
+  size_t o = 0;
+  while (i < length) {
+    size_t n = k.narrow(src + i, length - i, dst + o);
+    i += n;
+    o += n;
+    if (i >= length) {
+      break;
+    }
+    uint32_t cp = src[i++];
+    if (isHighSurrogate(cp) && i < length && isLowSurrogate(src[i])) {
+      cp = 0x10000 + ((cp - 0xd800) << 10) + (src[i++] - 0xdc00);
+    } else if (isHighSurrogate(cp) || isLowSurrogate(cp)) {
+      cp = kReplacement;
+    }
+    o += putUtf8(cp, dst + o);
+  }
+  return o;
+}
+
+size_t StringTranscoder::utf8ToModifiedUtf8(const char* src, size_t length, char* dst) {
+  const Kernels& k = kernels();
+  size_t i = 0;
+  size_t o = 0;
+  while (i < length) {
+    size_t n = k.ascii_span(src + i, length - i);
+    memcpy(dst + o, src + i, n);
+    i += n;
+    o += n;
+    if (i >= length) {
+      break;
+    }
+    size_t consumed;
+    uint32_t cp = decodeUtf8((const unsigned char*) src + i, length - i, &consumed, false);
+    i += consumed;
+    o += putModifiedUtf8(cp, dst + o);
+  }
+  return o;
+}
+
+size_t StringTranscoder::modifiedUtf8ToUtf8(const char* src, size_t length, char* dst) {
+  const Kernels& k = kernels();
+  size_t i = 0;
+  size_t o = 0;
+  while (i < length) {
+    size_t n = k.ascii_span(src + i, length - i);
+    memcpy(dst + o, src + i, n);
+    i += n;
+    o += n;
+    if (i >= length) {
+      break;
+    }
+    size_t consumed;
+    uint32_t cp = decodeUtf8((const unsigned char*) src + i, length - i, &consumed, true);
+    i += consumed;
+    if (isHighSurrogate(cp) && i < length) {
+      size_t low_consumed;
+      uint32_t low = decodeUtf8((const unsigned char*) src + i, length - i, &low_consumed, true);
+      if (isLowSurrogate(low)) {
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+        i += low_consumed;
+      }
+    }
+    if (isHighSurrogate(cp) || isLowSurrogate(cp)) {
+      cp = kReplacement;
+    }
+    o += putUtf8(cp, dst + o);
+  }
+  return o;
+}
+
+jstring StringTranscoder::newString(JNIEnv* env, const char* utf8, size_t length) {
+  jchar inline_buffer[256];
+  std::vector<jchar> heap_buffer;
+  jchar* buffer = inline_buffer;
+  if (length > sizeof(inline_buffer) / sizeof(inline_buffer[0])) {
+    heap_buffer.resize(length);
+    buffer = heap_buffer.data();
+  }
+  size_t units = utf8ToUtf16(utf8, length, buffer);
+  return env->NewString(buffer, (jsize) units);
+}
+
+bool StringTranscoder::getString(JNIEnv* env, jstring str, std::string* utf8) {
+  jsize length = env->GetStringLength(str);
+  jchar inline_buffer[256];
+  std::vector<jchar> heap_buffer;
+  jchar* buffer = inline_buffer;
+  if ((size_t) length > sizeof(inline_buffer) / sizeof(inline_buffer[0])) {
+    heap_buffer.resize(length);
+    buffer = heap_buffer.data();
+  }
+  env->GetStringRegion(str, 0, length, buffer);
+  if (env->ExceptionCheck()) {
+    return false;
+  }
+  utf8->resize((size_t) length * 3);
+  utf8->resize(utf16ToUtf8(buffer, length, &(*utf8)[0]));
+  return true;
+}
+
+const char* StringTranscoder::implementation() {
+  return kernels().name;
+}
+
+} // namespace jvm
+} // namespace jcu
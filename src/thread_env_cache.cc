@@ -0,0 +1,91 @@
+/**
+ * @file	thread_env_cache.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/10
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <atomic>
+
+#include "thread_env_cache.h"
+#include "thread_key.h"
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+static std::atomic<uint32_t> s_last_generation(0);
+static std::atomic<uint32_t> s_live_generation(0);
+
+static thread_local ThreadEnvCache::Entry* t_entry = nullptr;
+
+static void onThreadExit(void* value) {
+  ThreadEnvCache::Entry* entry = (ThreadEnvCache::Entry*) value;
+  if (entry->attached && entry->env && entry->generation == s_live_generation.load(std::memory_order_acquire)) {
+    entry->jvm->DetachCurrentThread();
+  }
+  delete entry;
+}
+
+static ThreadKey* threadKey() {
+  // Never deleted: threads may still exit after static destruction.
+  static ThreadKey* key = new ThreadKey(onThreadExit);
+  return key;
+}
+
+uint32_t ThreadEnvCache::activate() {
+  uint32_t generation = s_last_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (generation == 0) {
+    generation = s_last_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  s_live_generation.store(generation, std::memory_order_release);
+  return generation;
+}
+
+void ThreadEnvCache::deactivate(uint32_t generation) {
+  s_live_generation.compare_exchange_strong(generation, 0, std::memory_order_acq_rel);
+}
+
+JNIEnv* ThreadEnvCache::get(uint32_t generation) {
+  Entry* entry = t_entry;
+  if (entry && entry->generation == generation) {
+    return entry->env;
+  }
+  return nullptr;
+}
+
+bool ThreadEnvCache::put(JavaVM* jvm, uint32_t generation, JNIEnv* env, bool attached) {
+  Entry* entry = t_entry;
+  if (!entry) {
+    ThreadKey* key = threadKey();
+    entry = new Entry();
+    if (!key->set(entry)) {
+      delete entry;
+      return false;
+    }
+    t_entry = entry;
+  }
+  entry->jvm = jvm;
+  entry->env = env;
+  entry->generation = generation;
+  entry->attached = attached;
+  return true;
+}
+
+bool ThreadEnvCache::remove(uint32_t generation) {
+  Entry* entry = t_entry;
+  bool attached = false;
+  if (entry && entry->generation == generation) {
+    attached = entry->attached;
+    entry->env = nullptr;
+    entry->attached = false;
+    entry->generation = 0;
+  }
+  return attached;
+}
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
@@ -0,0 +1,55 @@
+/**
+ * @file	thread_env_cache.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/10
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_THREAD_ENV_CACHE_H_
+#define JCU_JVM_SRC_THREAD_ENV_CACHE_H_
+
+#include <stdint.h>
+
+#include <jni.h>
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+/**
+ * Process wide per-thread JNIEnv cache.
+ *
+ * Every VM session gets a generation number from activate(). Cached entries
+ * belonging to another generation are treated as misses, so entries left
+ * over from a destroyed VM are never handed out.
+ * Threads attached through the cache are detached automatically at thread exit.
+ */
+class ThreadEnvCache {
+ public:
+  struct Entry {
+    JavaVM* jvm;
+    JNIEnv* env;
+    uint32_t generation;
+    bool attached;
+  };
+
+  static uint32_t activate();
+  static void deactivate(uint32_t generation);
+
+  static JNIEnv* get(uint32_t generation);
+  static bool put(JavaVM* jvm, uint32_t generation, JNIEnv* env, bool attached);
+
+  /**
+   * Forget the entry of the calling thread
+   * @return true if the calling thread was attached through the cache
+   */
+  static bool remove(uint32_t generation);
+};
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif // JCU_JVM_SRC_THREAD_ENV_CACHE_H_
@@ -0,0 +1,58 @@
+/**
+ * @file	thread_key.h
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/10
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#ifndef JCU_JVM_SRC_THREAD_KEY_H_
+#define JCU_JVM_SRC_THREAD_KEY_H_
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace jcu {
+namespace jvm {
+namespace intl {
+
+/**
+ * Thread specific storage slot with a destructor called at thread exit
+ * (pthread key on unix, fiber local storage on windows).
+ */
+class ThreadKey {
+ public:
+  typedef void (*Destructor)(void* value);
+
+ private:
+#ifdef _WIN32
+  DWORD key_;
+#else
+  pthread_key_t key_;
+#endif
+  bool valid_;
+
+ public:
+  explicit ThreadKey(Destructor destructor);
+  ~ThreadKey();
+
+  ThreadKey(const ThreadKey&) = delete;
+  ThreadKey& operator=(const ThreadKey&) = delete;
+
+  bool isValid() const {
+    return valid_;
+  }
+
+  void* get() const;
+  bool set(void* value);
+};
+
+} // namespace intl
+} // namespace jvm
+} // namespace jcu
+
+#endif // JCU_JVM_SRC_THREAD_KEY_H_
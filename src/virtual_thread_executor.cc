@@ -0,0 +1,166 @@
+/**
+ * @file	virtual_thread_executor.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/30
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <jcu-jvm/virtual_thread_executor.h>
+#include <jcu-jvm/id_registry.h>
+#include <jcu-jvm/java_exception.h>
+#include <jcu-jvm/string_transcoder.h>
+
+namespace jcu {
+namespace jvm {
+
+namespace {
+JCU_JVM_CLASS_KEY(JavaLangThread, "java/lang/Thread");
+JCU_JVM_STATIC_METHOD_KEY(JavaLangThreadOfVirtual, JavaLangThread, "ofVirtual", "()Ljava/lang/Thread$Builder$OfVirtual;");
+JCU_JVM_CLASS_KEY(JavaLangThreadBuilderOfVirtual, "java/lang/Thread$Builder$OfVirtual");
+JCU_JVM_METHOD_KEY(JavaLangThreadBuilderOfVirtualName, JavaLangThreadBuilderOfVirtual, "name", "(Ljava/lang/String;J)Ljava/lang/Thread$Builder$OfVirtual;");
+JCU_JVM_CLASS_KEY(JavaLangThreadBuilder, "java/lang/Thread$Builder");
+JCU_JVM_METHOD_KEY(JavaLangThreadBuilderFactory, JavaLangThreadBuilder, "factory", "()Ljava/util/concurrent/ThreadFactory;");
+JCU_JVM_CLASS_KEY(JavaUtilConcurrentExecutors, "java/util/concurrent/Executors");
+JCU_JVM_STATIC_METHOD_KEY(ExecutorsNewThreadPerTaskExecutor, JavaUtilConcurrentExecutors, "newThreadPerTaskExecutor",
+                          "(Ljava/util/concurrent/ThreadFactory;)Ljava/util/concurrent/ExecutorService;");
+JCU_JVM_CLASS_KEY(JavaUtilConcurrentExecutorService, "java/util/concurrent/ExecutorService");
+JCU_JVM_METHOD_KEY(ExecutorServiceShutdown, JavaUtilConcurrentExecutorService, "shutdown", "()V");
+JCU_JVM_CLASS_KEY(JavaUtilConcurrentCompletableFuture, "java/util/concurrent/CompletableFuture");
+JCU_JVM_STATIC_METHOD_KEY(CompletableFutureRunAsync, JavaUtilConcurrentCompletableFuture, "runAsync",
+                          "(Ljava/lang/Runnable;Ljava/util/concurrent/Executor;)Ljava/util/concurrent/CompletableFuture;");
+JCU_JVM_STATIC_METHOD_KEY(CompletableFutureSupplyAsync, JavaUtilConcurrentCompletableFuture, "supplyAsync",
+                          "(Ljava/util/function/Supplier;Ljava/util/concurrent/Executor;)Ljava/util/concurrent/CompletableFuture;");
+JCU_JVM_CLASS_KEY(JavaUtilFunctionSupplier, "java/util/function/Supplier");
+
+/**
+ * Executors.newThreadPerTaskExecutor(Thread.ofVirtual()[.name(prefix, 0)].factory())
+ * @return null with the exception pending
+ */
+jobject newVirtualThreadExecutor(JNIEnv* env, const char* thread_name_prefix) {
+  // each lookup leaves NoClassDefFoundError / NoSuchMethodError pending before JDK 21
+  jmethodID of_virtual = IdRegistry::getMethod<JavaLangThreadOfVirtual>(env);
+  if (!of_virtual) {
+    return nullptr;
+  }
+  jmethodID name = IdRegistry::getMethod<JavaLangThreadBuilderOfVirtualName>(env);
+  if (!name) {
+    return nullptr;
+  }
+  jmethodID factory = IdRegistry::getMethod<JavaLangThreadBuilderFactory>(env);
+  if (!factory) {
+    return nullptr;
+  }
+  jmethodID new_executor = IdRegistry::getMethod<ExecutorsNewThreadPerTaskExecutor>(env);
+  if (!new_executor) {
+    return nullptr;
+  }
+
+  jobject builder = env->CallStaticObjectMethod(IdRegistry::getClass<JavaLangThread>(env), of_virtual);
+  if (!builder) {
+    return nullptr;
+  }
+  if (thread_name_prefix) {
+    jstring prefix = StringTranscoder::newString(env, thread_name_prefix);
+    if (!prefix) {
+      env->DeleteLocalRef(builder);
+      return nullptr;
+    }
+    jobject named = env->CallObjectMethod(builder, name, prefix, (jlong) 0);
+    env->DeleteLocalRef(prefix);
+    env->DeleteLocalRef(builder);
+    if (!named) {
+      return nullptr;
+    }
+    builder = named;
+  }
+  jobject thread_factory = env->CallObjectMethod(builder, factory);
+  env->DeleteLocalRef(builder);
+  if (!thread_factory) {
+    return nullptr;
+  }
+  jobject executor = env->CallStaticObjectMethod(IdRegistry::getClass<JavaUtilConcurrentExecutors>(env), new_executor, thread_factory);
+  env->DeleteLocalRef(thread_factory);
+  return executor;
+}
+} // namespace
+
+class VirtualThreadExecutorImpl : public VirtualThreadExecutor {
+ private:
+  VM* vm_;
+  jobject executor_;
+
+ public:
+  VirtualThreadExecutorImpl(VM* vm, jobject executor)
+      : vm_(vm), executor_(executor) {}
+
+  ~VirtualThreadExecutorImpl() override {
+    if (executor_) {
+      JNIEnv* env = vm_->env();
+      if (env) {
+        shutdown(env);
+      }
+      // otherwise the vm is gone or the thread is not attached, the reference can only be leaked
+    }
+  }
+
+  jobject start(JNIEnv* env, jobject task) override {
+    if (!executor_) {
+      return nullptr;
+    }
+    jclass supplier = IdRegistry::getClass<JavaUtilFunctionSupplier>(env);
+    if (!supplier) {
+      return nullptr;
+    }
+    jmethodID method = env->IsInstanceOf(task, supplier)
+        ? IdRegistry::getMethod<CompletableFutureSupplyAsync>(env)
+        : IdRegistry::getMethod<CompletableFutureRunAsync>(env);
+    if (!method) {
+      return nullptr;
+    }
+    return env->CallStaticObjectMethod(IdRegistry::getClass<JavaUtilConcurrentCompletableFuture>(env), method, task, executor_);
+  }
+
+  bool submit(JNIEnv* env, jobject task, JavaFutures::Executor executor, JavaFutures::Callback callback) override {
+    jobject future = start(env, task);
+    if (!future) {
+      return false;
+    }
+    bool attached = JavaFutures::whenComplete(vm_, env, future, std::move(executor), std::move(callback));
+    env->DeleteLocalRef(future);
+    return attached;
+  }
+
+  void shutdown(JNIEnv* env) override {
+    if (!executor_) {
+      return;
+    }
+    jmethodID method = IdRegistry::getMethod<ExecutorServiceShutdown>(env);
+    if (method) {
+      env->CallVoidMethod(executor_, method);
+    }
+    JavaExceptions::take(env);
+    env->DeleteGlobalRef(executor_);
+    executor_ = nullptr;
+  }
+};
+
+VirtualThreadExecutor* VirtualThreadExecutor::create(VM* vm, JNIEnv* env, const Options& options) {
+  jobject executor = newVirtualThreadExecutor(env, options.thread_name_prefix);
+  if (!executor) {
+    // NoSuchMethodError before JDK 21
+    JavaExceptions::take(env);
+    return nullptr;
+  }
+  jobject global_ref = env->NewGlobalRef(executor);
+  env->DeleteLocalRef(executor);
+  if (!global_ref) {
+    JavaExceptions::take(env);
+    return nullptr;
+  }
+  return new VirtualThreadExecutorImpl(vm, global_ref);
+}
+
+} // namespace jvm
+} // namespace jcu
@@ -10,16 +10,32 @@
 #include <stdlib.h>
 #include <stdarg.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <jcu-jvm/pointer_ref.h>
 #include <jcu-jvm/vm.h>
+#include <jcu-jvm/method.h>
+#include <jcu-jvm/java_exception.h>
+#include <jcu-jvm/foreign_function.h>
 
 #include <intl_utils.h>
 
-#include "simple_memory_pool.h"
+#include "thread_env_cache.h"
+#include "cds_archive.h"
+#include "java_future_intl.h"
 
 namespace jcu {
 namespace jvm {
 
+namespace {
+JCU_JVM_CLASS_KEY(JavaLangSystem, "java/lang/System");
+JCU_JVM_TYPED_STATIC_METHOD_KEY(JavaLangSystemExit, JavaLangSystem, "exit", void(jint));
+} // namespace
+
 extern "C" {
 
 static void _java_exit(int x) {
@@ -44,36 +60,93 @@ class VMImpl : public VM {
   JavaVM* jvm_;
   JNIEnv* env_;
   jint jni_ver_;
-
-  jclass cls_system_;
+  uint32_t generation_;
+
+  std::string cds_archive_dir_;
+
+  /**
+   * the library accepted JNI_VERSION_21, the java.lang.foreign linker may be available
+   */
+  bool foreign_linker_;
+  bool native_access_;
+
+  /**
+   * phases of init(), the library phases are merged in getStartupTrace()
+   */
+  StartupTrace startup_trace_;
+
+  std::unique_ptr<HandleTable> handles_;
+
+  /**
+   * callables bound by registerNatives(), the trampolines point into them
+   */
+  std::mutex natives_mutex_;
+  struct NativeState {
+    std::shared_ptr<void> state;
+    void (*uninstall)(void* state);
+  };
+  std::vector<NativeState> native_states_;
+
+  /**
+   * owner thread started by initAsync()
+   */
+  std::thread owner_thread_;
+  std::mutex owner_mutex_;
+  std::condition_variable owner_cond_;
+  bool owner_destroy_requested_;
+  jint owner_destroy_rc_;
 
   VMImpl(PointerRef<JvmLibrary>&& jvm_library) {
     jvm_library_ = std::move(jvm_library);
     os_handler_ = jvm_library_->getOsHandle();
+    handles_.reset(HandleTable::create());
+    owner_destroy_requested_ = false;
+    owner_destroy_rc_ = -1;
+    native_access_ = false;
     clear();
   }
 
   ~VMImpl() {
     destroy();
+    std::lock_guard<std::mutex> lock(natives_mutex_);
+    for (const NativeState& native_state : native_states_) {
+      native_state.uninstall(native_state.state.get());
+    }
   }
 
   void clear() {
     jvm_ = nullptr;
     env_ = nullptr;
-    cls_system_ = nullptr;
     jni_ver_ = 0;
+    generation_ = 0;
+    foreign_linker_ = false;
   }
 
   jint init(const char* classpath, const JavaVMInitArgs* custom_init_args, MemoryPool* mpool) override {
-    std::unique_ptr<intl::SimpleMemoryPool> allocated_pool;
+    destroy();
+    return initImpl(classpath, custom_init_args, mpool);
+  }
+
+  /**
+   * init() without the leading destroy(), also run by the owner thread of
+   * initAsync() which must not touch owner_thread_
+   */
+  jint initImpl(const char* classpath, const JavaVMInitArgs* custom_init_args, MemoryPool* mpool) {
+    char inline_block[1024];
+    std::unique_ptr<MemoryPool> allocated_pool;
     JavaVMInitArgs init_args = { 0 };
     int opt;
     jint rc;
+    std::string cds_option;
+    uint64_t begin;
 
-    destroy();
+    startup_trace_.reset();
 
     if (!mpool) {
-      allocated_pool.reset(new intl::SimpleMemoryPool());
+      ArenaMemoryPool::Options pool_options;
+      pool_options.inline_block = inline_block;
+      pool_options.inline_block_size = sizeof(inline_block);
+      allocated_pool.reset(createArenaMemoryPool(pool_options));
       mpool = allocated_pool.get();
     }
 
@@ -90,8 +163,23 @@ class VMImpl : public VM {
       init_args.version = JNI_VERSION_1_8;
     }
 
+    begin = StartupTrace::now();
     jvm_library_->JNI_GetDefaultJavaVMInitArgs((void*)&init_args);
+    {
+      JavaVMInitArgs probe_args = { 0 };
+      probe_args.version = JCU_JVM_JNI_VERSION_21;
+      foreign_linker_ = (jvm_library_->JNI_GetDefaultJavaVMInitArgs((void*)&probe_args) == JNI_OK);
+    }
+    startup_trace_.record(StartupTrace::kPhaseGetDefaultInitArgs, begin, StartupTrace::now());
     init_args.ignoreUnrecognized = JNI_TRUE;
+    if (foreign_linker_ && native_access_) {
+      init_args.nOptions++;
+    }
+
+    begin = StartupTrace::now();
+    if (prepareCdsArchive(classpath, custom_init_args, &cds_option)) {
+      init_args.nOptions++;
+    }
 
     jni_ver_ = init_args.version;
 
@@ -114,6 +202,16 @@ class VMImpl : public VM {
       item->optionString = intl::mpollStrdup(mpool, temp.c_str());
       item->extraInfo = nullptr;
     }
+    if (!cds_option.empty()) {
+      JavaVMOption* item = &init_args.options[opt++];
+      item->optionString = intl::mpollStrdup(mpool, cds_option.c_str());
+      item->extraInfo = nullptr;
+    }
+    if (foreign_linker_ && native_access_) {
+      JavaVMOption* item = &init_args.options[opt++];
+      item->optionString = intl::mpollStrdup(mpool, "--enable-native-access=ALL-UNNAMED");
+      item->extraInfo = nullptr;
+    }
     {
       JavaVMOption* item = &init_args.options[opt++];
       item->optionString = intl::mpollStrdup(mpool, "exit");
@@ -144,21 +242,185 @@ class VMImpl : public VM {
       item->extraInfo = (void*) nullptr;
     }
 
+    startup_trace_.record(StartupTrace::kPhaseBuildOptions, begin, StartupTrace::now());
+
+    begin = StartupTrace::now();
     rc = jvm_library_->JNI_CreateJavaVM(&jvm_, &env_, &init_args);
+    startup_trace_.record(StartupTrace::kPhaseCreateJavaVM, begin, StartupTrace::now());
+    if (rc != JNI_OK) {
+      clear();
+      return rc;
+    }
 
-    cls_system_ = env_->FindClass("java/lang/System");
+    // The creating thread is attached by JNI_CreateJavaVM and stays attached until destroy().
+    generation_ = intl::ThreadEnvCache::activate();
+    intl::ThreadEnvCache::put(jvm_, generation_, env_, false);
+
+    begin = StartupTrace::now();
+    IdRegistry::getClass<JavaLangSystem>(env_);
+    startup_trace_.record(StartupTrace::kPhaseFirstFindClass, begin, StartupTrace::now());
+    // do not leave the creating thread with a pending exception
+    JavaExceptions::take(env_);
 
     return rc;
   }
 
+  void setCdsArchiveDir(const char* dir) override {
+    cds_archive_dir_ = dir ? dir : "";
+  }
+
+  void setNativeAccess(bool enable) override {
+    native_access_ = enable;
+  }
+
+  bool foreignLinkerSupported() const override {
+    return foreign_linker_;
+  }
+
+  bool prepareCdsArchive(const char* classpath, const JavaVMInitArgs* custom_init_args, std::string* option) const {
+    const char* jvm_path = jvm_library_->getJvmPath();
+    if (cds_archive_dir_.empty() || !jvm_path) {
+      return false;
+    }
+    if (custom_init_args) {
+      for (int i = 0; i < custom_init_args->nOptions; i++) {
+        if (intl::CdsArchive::isUserManaged(custom_init_args->options[i].optionString)) {
+          return false;
+        }
+      }
+    }
+
+    intl::CdsArchiveKey key;
+    key.classpath = classpath ? classpath : "";
+    key.jvm_path = jvm_path;
+    key.jvm_fingerprint = os_handler_->getFileFingerprint(jvm_path);
+    intl::CdsArchive archive(cds_archive_dir_);
+    return archive.prepare(key, std::to_string(os_handler_->getCurrentPid()), option) != intl::CdsArchive::kModeNone;
+  }
+
   void callExit(jint code) {
-    jmethodID method = env_->GetStaticMethodID(cls_system_, "exit", "(I)V");
-    env_->CallStaticVoidMethod(cls_system_, method, code);
+    JNIEnv* env = this->env();
+    if (!env) return;
+    JavaLangSystemExit::call(env, code);
+    // e.g. SecurityException
+    JavaExceptions::take(env);
+  }
+
+  std::future<jint> initAsync(
+      const char* classpath,
+      const JavaVMInitArgs* custom_init_args,
+      std::function<void(jint)> on_complete,
+      const JvmLibraryPathInfo* path_info,
+      bool jsig_load) override {
+    struct Params {
+      bool has_classpath;
+      std::string classpath;
+      bool has_init_args;
+      JavaVMInitArgs init_args;
+      std::vector<std::string> option_strings;
+      std::vector<JavaVMOption> options;
+      bool has_path_info;
+      JvmLibraryPathInfo path_info;
+      bool jsig_load;
+      std::function<void(jint)> on_complete;
+      std::promise<jint> promise;
+    };
+    std::shared_ptr<Params> params(new Params());
+
+    destroy();
+
+    params->has_classpath = (classpath != nullptr);
+    if (classpath) {
+      params->classpath = classpath;
+    }
+    params->has_init_args = (custom_init_args != nullptr);
+    if (custom_init_args) {
+      params->init_args = *custom_init_args;
+      params->option_strings.reserve(custom_init_args->nOptions);
+      for (int i = 0; i < custom_init_args->nOptions; i++) {
+        params->option_strings.emplace_back(custom_init_args->options[i].optionString);
+      }
+      for (int i = 0; i < custom_init_args->nOptions; i++) {
+        JavaVMOption option;
+        option.optionString = (char*) params->option_strings[i].c_str();
+        option.extraInfo = custom_init_args->options[i].extraInfo;
+        params->options.push_back(option);
+      }
+      params->init_args.options = params->options.data();
+    }
+    params->has_path_info = (path_info != nullptr);
+    if (path_info) {
+      params->path_info = *path_info;
+    }
+    params->jsig_load = jsig_load;
+    params->on_complete = std::move(on_complete);
+
+    std::future<jint> future = params->promise.get_future();
+    owner_destroy_requested_ = false;
+    std::unique_lock<std::mutex> publish_lock(owner_mutex_);
+    owner_thread_ = std::thread([this, params]() -> void {
+      jint rc = JNI_OK;
+
+      if (!jvm_library_->isLoaded()) {
+        JvmLibraryPathInfo info = params->has_path_info ? params->path_info : os_handler_->findJvmLibrary();
+        if (jvm_library_->load(info, params->jsig_load) != 0) {
+          rc = JNI_ERR;
+        }
+      }
+      if (rc == JNI_OK) {
+        rc = initImpl(
+            params->has_classpath ? params->classpath.c_str() : nullptr,
+            params->has_init_args ? &params->init_args : nullptr,
+            nullptr);
+      }
+
+      {
+        // owner_thread_ is published, on_complete may call destroy()
+        std::lock_guard<std::mutex> lock(owner_mutex_);
+      }
+      if (params->on_complete) {
+        params->on_complete(rc);
+      }
+      params->promise.set_value(rc);
+      if (rc != JNI_OK) {
+        return;
+      }
+
+      // stay attached as the primordial thread until destroy()
+      std::unique_lock<std::mutex> lock(owner_mutex_);
+      owner_cond_.wait(lock, [this]() -> bool { return owner_destroy_requested_; });
+      owner_destroy_rc_ = destroyOnCurrentThread();
+    });
+    publish_lock.unlock();
+
+    return future;
   }
 
   jint destroy() override {
+    if (owner_thread_.joinable()) {
+      if (owner_thread_.get_id() != std::this_thread::get_id()) {
+        {
+          std::lock_guard<std::mutex> lock(owner_mutex_);
+          owner_destroy_requested_ = true;
+          owner_destroy_rc_ = -1;
+        }
+        owner_cond_.notify_all();
+        owner_thread_.join();
+        return owner_destroy_rc_;
+      }
+      // on_complete of initAsync() on the owner thread
+    }
+    return destroyOnCurrentThread();
+  }
+
+  jint destroyOnCurrentThread() {
     jint rc = -1;
     if (jvm_) {
+      handles_->clear(env());
+      IdRegistry::reset(env());
+      intl::forgetNativeCompletion(this);
+      intl::ThreadEnvCache::remove(generation_);
+      intl::ThreadEnvCache::deactivate(generation_);
       rc = jvm_->DestroyJavaVM();
     }
     clear();
@@ -166,33 +428,164 @@ class VMImpl : public VM {
   }
 
 
+  StartupTrace getStartupTrace() const override {
+    StartupTrace trace(jvm_library_->getStartupTrace());
+    for (int i = StartupTrace::kPhaseGetDefaultInitArgs; i < StartupTrace::kPhaseCount; i++) {
+      StartupTrace::Phase phase = (StartupTrace::Phase) i;
+      trace.set(phase, startup_trace_.get(phase));
+    }
+    return trace;
+  }
+
+  HandleTable* handles() override {
+    return handles_.get();
+  }
+
+  /**
+   * Uninstall and drop the states pushed after the first installed ones,
+   * except those registered before (requires natives_mutex_)
+   */
+  void rollbackNatives(size_t installed) {
+    while (native_states_.size() > installed) {
+      void* state = native_states_.back().state.get();
+      bool registered_before = false;
+      for (size_t i = 0; i < installed; i++) {
+        registered_before = registered_before || native_states_[i].state.get() == state;
+      }
+      if (!registered_before) {
+        native_states_.back().uninstall(state);
+      }
+      native_states_.pop_back();
+    }
+  }
+
+  jint registerNatives(JNIEnv* env, jclass clazz, const NativeMethods& methods) override {
+    if (!methods.valid()) {
+      return JNI_ERR;
+    }
+    std::vector<JNINativeMethod> table;
+    table.reserve(methods.size());
+    std::lock_guard<std::mutex> lock(natives_mutex_);
+    size_t installed = native_states_.size();
+    for (const NativeMethods::Entry& entry : methods.entries()) {
+      JNINativeMethod method;
+      method.name = const_cast<char*>(entry.name.c_str());
+      method.signature = const_cast<char*>(entry.signature.c_str());
+      method.fnPtr = entry.fn;
+      if (entry.install) {
+        method.fnPtr = entry.install(entry.state.get());
+        if (!method.fnPtr) {
+          // the lambda expression serves another registration or no slot is free
+          rollbackNatives(installed);
+          return JNI_ERR;
+        }
+        native_states_.push_back(NativeState{entry.state, entry.uninstall});
+      }
+      table.push_back(method);
+    }
+    jint rc = env->RegisterNatives(clazz, table.data(), (jint) table.size());
+    if (rc != JNI_OK) {
+      // the methods before the failing one are bound to trampolines about
+      // to be uninstalled, unbind them keeping the pending exception
+      jthrowable exception = env->ExceptionOccurred();
+      env->ExceptionClear();
+      env->UnregisterNatives(clazz);
+      if (exception) {
+        env->Throw(exception);
+        env->DeleteLocalRef(exception);
+      }
+      rollbackNatives(installed);
+    }
+    return rc;
+  }
+
+  jint registerNatives(JNIEnv* env, const char* class_name, const NativeMethods& methods) override {
+    jclass clazz = env->FindClass(class_name);
+    if (!clazz) {
+      return JNI_ERR;
+    }
+    jint rc = registerNatives(env, clazz, methods);
+    env->DeleteLocalRef(clazz);
+    return rc;
+  }
+
   virtual JavaVM* jvm() const override {
     return jvm_;
   }
   virtual JNIEnv* env() const override {
-    return env_;
+    JNIEnv* env = intl::ThreadEnvCache::get(generation_);
+    if (!env && jvm_) {
+      // attached by someone else (e.g. a java thread calling into native)
+      if (jvm_->GetEnv((void**)&env, jni_ver_) != JNI_OK) {
+        env = nullptr;
+      }
+    }
+    return env;
   }
 
   jint attachThread(bool* attached) override {
-    return attachThreadEnv(&env_, attached);
+    JNIEnv* env = nullptr;
+    return attachThreadEnv(&env, attached, nullptr, false);
   }
 
   jint attachThreadEnv(JNIEnv** env, bool* attached) override {
-    jint rc = jvm_->GetEnv((void**)env, jni_ver_);
-    if (rc != JNI_OK) {
-      if (rc == JNI_EDETACHED) {
-        rc = jvm_->AttachCurrentThread((void**)env, nullptr);
+    return attachThreadEnv(env, attached, nullptr, false);
+  }
+
+  jint attachThreadEnv(JNIEnv** env, bool* attached, const char* thread_name, bool daemon) override {
+    jint rc;
+
+    if (attached) *attached = false;
+
+    if (!jvm_) {
+      *env = nullptr;
+      return JNI_ERR;
+    }
+
+    *env = intl::ThreadEnvCache::get(generation_);
+    if (*env) {
+      return JNI_OK;
+    }
+
+    rc = jvm_->GetEnv((void**)env, jni_ver_);
+    if (rc == JNI_OK) {
+      // attached outside of this library: cache it but never detach it.
+      intl::ThreadEnvCache::put(jvm_, generation_, *env, false);
+      return rc;
+    }
+
+    if (rc == JNI_EDETACHED) {
+      JavaVMAttachArgs attach_args = { 0 };
+      attach_args.version = jni_ver_;
+      attach_args.name = (char*)thread_name;
+      attach_args.group = nullptr;
+      if (daemon) {
+        rc = jvm_->AttachCurrentThreadAsDaemon((void**)env, &attach_args);
+      } else {
+        rc = jvm_->AttachCurrentThread((void**)env, &attach_args);
+      }
+      if (rc == JNI_OK) {
         if (attached) *attached = true;
+        if (!intl::ThreadEnvCache::put(jvm_, generation_, *env, true)) {
+          // without a cache entry nobody would detach this thread at exit
+          jvm_->DetachCurrentThread();
+          if (attached) *attached = false;
+          rc = JNI_ENOMEM;
+        }
       }
     }
+
     if (rc != JNI_OK) {
       *env = nullptr;
-      return false;
     }
     return rc;
   }
 
   jint detachThread() override {
+    if (!jvm_) {
+      return JNI_ERR;
+    }
+    intl::ThreadEnvCache::remove(generation_);
     return jvm_->DetachCurrentThread();
   }
 };
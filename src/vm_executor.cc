@@ -0,0 +1,241 @@
+/**
+ * @file	vm_executor.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/09/21
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <jcu-jvm/vm_executor.h>
+#include <jcu-jvm/local_ref.h>
+#include <jcu-jvm/java_exception.h>
+
+namespace jcu {
+namespace jvm {
+
+class VmExecutorImpl : public VmExecutor {
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  VM* vm_;
+  Options options_;
+  std::string thread_name_prefix_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  std::condition_variable started_cond_;
+  size_t started_count_;
+  std::atomic<size_t> attached_count_;
+  /**
+   * tasks in all deques (plus ones being pushed), incremented under idle_mutex_
+   */
+  std::atomic<size_t> pending_;
+  std::atomic<size_t> next_worker_;
+  bool stopping_;
+  std::atomic<bool> accepting_;
+
+  /**
+   * worker of the calling thread, null for other threads
+   */
+  static thread_local Worker* current_worker_;
+  static thread_local VmExecutorImpl* current_executor_;
+
+ public:
+  VmExecutorImpl(VM* vm, const Options& options)
+      : vm_(vm), options_(options), started_count_(0), attached_count_(0),
+        pending_(0), next_worker_(0), stopping_(false), accepting_(false) {
+    if (options.thread_name_prefix) {
+      thread_name_prefix_ = options.thread_name_prefix;
+    }
+    if (!options_.thread_count) {
+      options_.thread_count = std::thread::hardware_concurrency();
+      if (!options_.thread_count) {
+        options_.thread_count = 1;
+      }
+    }
+
+    workers_.reserve(options_.thread_count);
+    for (size_t i = 0; i < options_.thread_count; i++) {
+      workers_.emplace_back(new Worker());
+    }
+    for (size_t i = 0; i < options_.thread_count; i++) {
+      workers_[i]->thread = std::thread(&VmExecutorImpl::run, this, i);
+    }
+
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    started_cond_.wait(lock, [this]() -> bool { return started_count_ == workers_.size(); });
+    accepting_ = attached_count_ > 0;
+  }
+
+  ~VmExecutorImpl() override {
+    shutdown();
+  }
+
+  bool submit(Task task) override {
+    // a worker keeps running until its own deque is empty, so tasks may still
+    // queue follow-up work while shutdown() drains the queues
+    Worker* worker = (current_executor_ == this) ? current_worker_ : nullptr;
+    if (!worker && !accepting_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    if (!worker) {
+      worker = workers_[next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size()].get();
+    }
+    {
+      // counted first so that pending_ never drops below the deque contents
+      std::lock_guard<std::mutex> lock(idle_mutex_);
+      pending_.fetch_add(1, std::memory_order_release);
+    }
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->tasks.emplace_back(std::move(task));
+    }
+    idle_cond_.notify_one();
+    return true;
+  }
+
+  size_t threadCount() const override {
+    return workers_.size();
+  }
+
+  size_t attachedCount() const override {
+    return attached_count_.load();
+  }
+
+  void shutdown() override {
+    accepting_ = false;
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex_);
+      stopping_ = true;
+    }
+    idle_cond_.notify_all();
+    for (auto it = workers_.begin(); it != workers_.end(); it++) {
+      // called from a task: the calling worker drains its deque once the task
+      // returns and is joined by the destructor
+      bool self = current_executor_ == this && current_worker_ == it->get();
+      if (!self && (*it)->thread.joinable()) {
+        (*it)->thread.join();
+      }
+    }
+  }
+
+ private:
+  bool popOwn(Worker* worker, Task* task) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->tasks.empty()) {
+      return false;
+    }
+    *task = std::move(worker->tasks.back());
+    worker->tasks.pop_back();
+    return true;
+  }
+
+  bool steal(size_t self, Task* task) {
+    for (size_t n = 1; n < workers_.size(); n++) {
+      Worker* victim = workers_[(self + n) % workers_.size()].get();
+      std::lock_guard<std::mutex> lock(victim->mutex);
+      if (!victim->tasks.empty()) {
+        *task = std::move(victim->tasks.front());
+        victim->tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool take(size_t index, Task* task) {
+    if (popOwn(workers_[index].get(), task) || steal(index, task)) {
+      pending_.fetch_sub(1, std::memory_order_acq_rel);
+      return true;
+    }
+    return false;
+  }
+
+  void run(size_t index) {
+    JNIEnv* env = nullptr;
+    bool attached = false;
+    std::string name;
+    if (!thread_name_prefix_.empty()) {
+      name = thread_name_prefix_ + "-" + std::to_string(index);
+    }
+    jint rc = vm_->attachThreadEnv(&env, &attached, name.empty() ? nullptr : name.c_str(), options_.daemon);
+
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex_);
+      if (rc == JNI_OK) {
+        attached_count_++;
+      }
+      started_count_++;
+    }
+    started_cond_.notify_all();
+    if (rc != JNI_OK) {
+      return;
+    }
+
+    current_worker_ = workers_[index].get();
+    current_executor_ = this;
+
+    Task task;
+    for (;;) {
+      if (take(index, &task)) {
+        {
+          // locals of a task must not pile up on this long lived thread
+          LocalFrame frame(env, options_.local_capacity);
+#if JCU_JVM_EXCEPTIONS
+          try {
+            task(env);
+          } catch (...) {
+            // dropped like a pending java exception, it must not unwind out of the worker
+          }
+#else
+          task(env);
+#endif
+        }
+        task = nullptr;
+        if (env->ExceptionCheck()) {
+          env->ExceptionClear();
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(idle_mutex_);
+      if (stopping_ && pending_.load(std::memory_order_acquire) == 0) {
+        break;
+      }
+      idle_cond_.wait(lock, [this]() -> bool {
+        return stopping_ || pending_.load(std::memory_order_acquire) > 0;
+      });
+    }
+
+    current_worker_ = nullptr;
+    current_executor_ = nullptr;
+    if (attached) {
+      vm_->detachThread();
+    }
+  }
+};
+
+thread_local VmExecutorImpl::Worker* VmExecutorImpl::current_worker_ = nullptr;
+thread_local VmExecutorImpl* VmExecutorImpl::current_executor_ = nullptr;
+
+VmExecutor* VmExecutor::create(VM* vm, const Options& options) {
+  return new VmExecutorImpl(vm, options);
+}
+
+} // namespace jvm
+} // namespace jcu
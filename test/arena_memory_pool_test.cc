@@ -0,0 +1,92 @@
+/**
+ * @file	arena_memory_pool_test.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/10/02
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+#include "../src/arena_memory_pool.h"
+
+namespace jcu {
+namespace jvm {
+namespace {
+
+int g_failures = 0;
+
+#define EXPECT(COND) \
+  do { \
+    if (!(COND)) { \
+      fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #COND); \
+      g_failures++; \
+    } \
+  } while (0)
+
+bool aligned(void* ptr, size_t alignment) {
+  return ((uintptr_t) ptr & (alignment - 1)) == 0;
+}
+
+/**
+ * alignment as large as the chunk: padding alone can exceed what a fresh chunk holds
+ */
+void testLargeAlignment() {
+  ArenaMemoryPool::Options options;
+  options.chunk_size = 4096;
+  options.alignment = 4096;
+  std::unique_ptr<ArenaMemoryPool> pool(createArenaMemoryPool(options));
+
+  for (int i = 0; i < 16; i++) {
+    void* ptr = pool->allocate(2048);
+    EXPECT(ptr != nullptr);
+    EXPECT(aligned(ptr, 4096));
+  }
+  void* small = pool->allocate(16);
+  EXPECT(small != nullptr);
+  EXPECT(aligned(small, 4096));
+  EXPECT(pool->getStats().chunk_count <= 17);
+}
+
+void testSmallAllocations() {
+  ArenaMemoryPool::Options options;
+  options.chunk_size = 256;
+  options.alignment = 16;
+  std::unique_ptr<ArenaMemoryPool> pool(createArenaMemoryPool(options));
+
+  char* previous = nullptr;
+  for (int i = 0; i < 100; i++) {
+    char* ptr = (char*) pool->allocate(24);
+    EXPECT(ptr != nullptr);
+    EXPECT(aligned(ptr, 16));
+    EXPECT(ptr != previous);
+    previous = ptr;
+  }
+  void* large = pool->allocate(1000);
+  EXPECT(large != nullptr);
+  EXPECT(aligned(large, 16));
+  EXPECT(pool->getStats().bytes_used == 100 * 24 + 1000);
+
+  pool->releaseAll();
+  EXPECT(pool->getStats().chunk_count == 1);
+  EXPECT(pool->getStats().bytes_used == 0);
+}
+
+} // namespace
+} // namespace jvm
+} // namespace jcu
+
+int main() {
+  using namespace jcu::jvm;
+  testLargeAlignment();
+  testSmallAllocations();
+  if (g_failures) {
+    fprintf(stderr, "%d failures\n", g_failures);
+    return 1;
+  }
+  return 0;
+}
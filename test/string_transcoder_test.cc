@@ -0,0 +1,166 @@
+/**
+ * @file	string_transcoder_test.cc
+ * @author	Joseph Lee <development@jc-lab.net>
+ * @date	2020/10/01
+ * @copyright Copyright (C) 2020 jc-lab.\n
+ *            This software may be modified and distributed under the terms
+ *            of the Apache License 2.0.  See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+// the kernels live in an anonymous namespace
+#include "../src/string_transcoder.cc"
+
+namespace jcu {
+namespace jvm {
+namespace {
+
+int g_failures = 0;
+
+#define EXPECT(COND) \
+  do { \
+    if (!(COND)) { \
+      fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #COND); \
+      g_failures++; \
+    } \
+  } while (0)
+
+std::vector<Kernels> availableKernels() {
+  std::vector<Kernels> result;
+  result.push_back(Kernels{"scalar", scalarAsciiSpan, scalarWiden, scalarNarrow});
+#if defined(JCU_JVM_TRANSCODER_SSE2)
+  result.push_back(Kernels{"sse2", sse2AsciiSpan, sse2Widen, sse2Narrow});
+#endif
+#if defined(JCU_JVM_TRANSCODER_AVX2)
+  if (cpuHasAvx2()) {
+    result.push_back(Kernels{"avx2", avx2AsciiSpan, avx2Widen, avx2Narrow});
+  }
+#endif
+#if defined(JCU_JVM_TRANSCODER_NEON)
+  result.push_back(Kernels{"neon", neonAsciiSpan, neonWiden, neonNarrow});
+#endif
+  return result;
+}
+
+/**
+ * ASCII runs of every length up to 100 with one unit from specials at every position
+ */
+void testKernelsAgree() {
+  const std::vector<Kernels> all = availableKernels();
+  const Kernels& reference = all[0];
+  const unsigned char special_bytes[] = {0x00, 0x7f, 0x80, 0xc0, 0xff};
+  const jchar special_units[] = {0x0000, 0x007f, 0x0080, 0x00ff, 0x0100, 0x8000, 0xd800, 0xffff};
+
+  for (size_t length = 0; length <= 100; length++) {
+    for (size_t position = 0; position <= length; position++) {
+      for (unsigned char special : special_bytes) {
+        std::string src(length, 'a');
+        for (size_t i = 0; i < length; i++) {
+          src[i] = (char) ('!' + (i % 90));
+        }
+        if (position < length) {
+          src[position] = (char) special;
+        }
+        std::vector<jchar> expected(length + 1, 0);
+        size_t expected_span = reference.ascii_span(src.data(), length);
+        size_t expected_widen = reference.widen(src.data(), length, expected.data());
+        for (const Kernels& k : all) {
+          std::vector<jchar> dst(length + 1, 0);
+          EXPECT(k.ascii_span(src.data(), length) == expected_span);
+          size_t n = k.widen(src.data(), length, dst.data());
+          EXPECT(n == expected_widen);
+          EXPECT(memcmp(dst.data(), expected.data(), n * sizeof(jchar)) == 0);
+        }
+      }
+      for (jchar special : special_units) {
+        std::vector<jchar> src(length);
+        for (size_t i = 0; i < length; i++) {
+          src[i] = (jchar) ('!' + (i % 90));
+        }
+        if (position < length) {
+          src[position] = special;
+        }
+        std::string expected(length + 1, '\0');
+        size_t expected_narrow = reference.narrow(src.data(), length, &expected[0]);
+        for (const Kernels& k : all) {
+          std::string dst(length + 1, '\0');
+          size_t n = k.narrow(src.data(), length, &dst[0]);
+          EXPECT(n == expected_narrow);
+          EXPECT(memcmp(dst.data(), expected.data(), n) == 0);
+        }
+      }
+    }
+  }
+}
+
+std::u16string toUtf16(const std::string& utf8) {
+  std::vector<jchar> dst(utf8.size() + 1);
+  size_t n = StringTranscoder::utf8ToUtf16(utf8.data(), utf8.size(), dst.data());
+  return std::u16string(dst.begin(), dst.begin() + n);
+}
+
+std::string toUtf8(const std::u16string& utf16) {
+  std::string dst(utf16.size() * 3 + 1, '\0');
+  size_t n = StringTranscoder::utf16ToUtf8((const jchar*) utf16.data(), utf16.size(), &dst[0]);
+  dst.resize(n);
+  return dst;
+}
+
+std::string toModified(const std::string& utf8) {
+  std::string dst(utf8.size() * 3 + 1, '\0');
+  dst.resize(StringTranscoder::utf8ToModifiedUtf8(utf8.data(), utf8.size(), &dst[0]));
+  return dst;
+}
+
+std::string fromModified(const std::string& modified) {
+  std::string dst(modified.size() * 3 + 1, '\0');
+  dst.resize(StringTranscoder::modifiedUtf8ToUtf8(modified.data(), modified.size(), &dst[0]));
+  return dst;
+}
+
+void testConversions() {
+  const std::string long_ascii(70, 'x');
+
+  // ascii runs around multi byte sequences
+  std::string mixed = long_ascii + "\xc3\xa9" + long_ascii + "\xf0\x9f\x98\x80" + long_ascii;
+  std::u16string mixed16 = toUtf16(mixed);
+  EXPECT(mixed16 == std::u16string(70, u'x') + u"é" + std::u16string(70, u'x') + u"\U0001F600" + std::u16string(70, u'x'));
+  EXPECT(toUtf8(mixed16) == mixed);
+
+  // invalid sequences become U+FFFD
+  EXPECT(toUtf16(long_ascii + "\xff" + "a") == std::u16string(70, u'x') + u"�a");
+  EXPECT(toUtf16("\xe2\x82") == u"�");
+  EXPECT(toUtf16("\xc0\x80") == u"��");
+  EXPECT(toUtf16("\xed\xa0\x80") == u"���");
+
+  // unpaired surrogates
+  EXPECT(toUtf8(std::u16string(1, (char16_t) 0xd800) + u"a") == "\xef\xbf\xbd" "a");
+  EXPECT(toUtf8(std::u16string(20, u'y') + std::u16string(1, (char16_t) 0xdc00)) == std::string(20, 'y') + "\xef\xbf\xbd");
+
+  // NUL and supplementary characters in modified UTF-8
+  std::string with_nul = long_ascii + std::string(1, '\0') + "\xf0\x9f\x98\x80";
+  std::string modified = toModified(with_nul);
+  EXPECT(modified == long_ascii + "\xc0\x80" + "\xed\xa0\xbd\xed\xb8\x80");
+  EXPECT(fromModified(modified) == with_nul);
+}
+
+} // namespace
+} // namespace jvm
+} // namespace jcu
+
+int main() {
+  using namespace jcu::jvm;
+  printf("implementation: %s\n", StringTranscoder::implementation());
+  testKernelsAgree();
+  testConversions();
+  if (g_failures) {
+    fprintf(stderr, "%d failures\n", g_failures);
+    return 1;
+  }
+  return 0;
+}